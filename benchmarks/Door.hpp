@@ -0,0 +1,76 @@
+#pragma once
+
+#include <cstdint>
+
+#include <fsm/actions/ByDefault.hpp>
+#include <fsm/actions/Maybe.hpp>
+#include <fsm/actions/Nothing.hpp>
+#include <fsm/actions/On.hpp>
+#include <fsm/actions/TransitionTo.hpp>
+#include <fsm/actions/Will.hpp>
+#include <fsm/StateMachine.hpp>
+
+namespace bench {
+
+using namespace fsm;
+
+struct OpenEvent {
+};
+
+struct CloseEvent {
+};
+
+struct LockEvent {
+    uint32_t newKey;
+};
+
+struct UnlockEvent {
+    uint32_t key;
+};
+
+struct ClosedState;
+struct OpenState;
+class LockedState;
+
+struct ClosedState : public Will<ByDefault<Nothing>,
+                                 On<LockEvent, TransitionTo<LockedState>>,
+                                 On<OpenEvent, TransitionTo<OpenState>>> {
+};
+
+struct OpenState : public Will<ByDefault<Nothing>, On<CloseEvent, TransitionTo<ClosedState>>> {
+};
+
+class LockedState : public ByDefault<Nothing> {
+public:
+    using ByDefault::handle;
+
+    LockedState(uint32_t key = 0) : key(key) {
+    }
+
+    void onEnter(const LockEvent& e) {
+        key = e.newKey;
+    }
+
+    Maybe<TransitionTo<ClosedState>> handle(const UnlockEvent& e) const {
+        if (e.key == key) {
+            return TransitionTo<ClosedState>{};
+        }
+        return Nothing{};
+    }
+
+private:
+    uint32_t key;
+};
+
+struct TablePolicy : DefaultPolicy {
+    using Dispatch = TableDispatch;
+    using Storage = IndexStorage;
+};
+
+template <class Policy>
+using BasicDoor = BasicStateMachine<Policy, ClosedState, OpenState, LockedState>;
+
+using Door = BasicDoor<DefaultPolicy>;
+using TableDoor = BasicDoor<TablePolicy>;
+
+}  // namespace bench
@@ -0,0 +1,36 @@
+#pragma once
+
+#include <cstddef>
+#include <utility>
+
+#include <fsm/actions/On.hpp>
+#include <fsm/actions/TransitionTo.hpp>
+#include <fsm/StateMachine.hpp>
+
+namespace bench {
+
+struct Tick {
+};
+
+/**
+ * @brief I'th state of a ring of N states, each Tick moves to the next one.
+ */
+template <std::size_t I, std::size_t N>
+struct RingState : fsm::On<Tick, fsm::TransitionTo<RingState<(I + 1) % N, N>>> {
+};
+
+template <class Policy, std::size_t N, typename = std::make_index_sequence<N>>
+struct ring_machine;
+
+template <class Policy, std::size_t N, std::size_t... Is>
+struct ring_machine<Policy, N, std::index_sequence<Is...>> {
+    using type = fsm::BasicStateMachine<Policy, RingState<Is, N>...>;
+};
+
+/**
+ * @brief Machine made of a ring of N states.
+ */
+template <class Policy, std::size_t N>
+using RingMachine = typename ring_machine<Policy, N>::type;
+
+}  // namespace bench
@@ -0,0 +1,738 @@
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <execution>
+#include <random>
+#include <thread>
+#include <variant>
+#include <vector>
+
+#include <benchmark/benchmark.h>
+
+#include <fsm/actions/After.hpp>
+#include <fsm/actions/If.hpp>
+#include <fsm/actions/OneOf.hpp>
+#include <fsm/DynamicMachine.hpp>
+#include <fsm/MachinePool.hpp>
+#include <fsm/Parallel.hpp>
+#include <fsm/Partition.hpp>
+#include <fsm/QueuedMachine.hpp>
+#include <fsm/Replayer.hpp>
+#include <fsm/observers/HistogramObserver.hpp>
+#include <fsm/observers/Recorder.hpp>
+#include <fsm/tools/EventView.hpp>
+
+#include "Door.hpp"
+#include "RingMachine.hpp"
+
+namespace bench {
+namespace {
+
+template <class Policy, std::size_t N>
+void BM_HandleRing(benchmark::State& state) {
+    RingMachine<Policy, N> machine;
+    for (auto _ : state) {
+        machine.handle(Tick{});
+        benchmark::DoNotOptimize(machine);
+    }
+    state.SetItemsProcessed(state.iterations());
+}
+
+BENCHMARK_TEMPLATE(BM_HandleRing, DefaultPolicy, 2);
+BENCHMARK_TEMPLATE(BM_HandleRing, DefaultPolicy, 8);
+BENCHMARK_TEMPLATE(BM_HandleRing, DefaultPolicy, 32);
+BENCHMARK_TEMPLATE(BM_HandleRing, DefaultPolicy, 128);
+BENCHMARK_TEMPLATE(BM_HandleRing, TablePolicy, 2);
+BENCHMARK_TEMPLATE(BM_HandleRing, TablePolicy, 8);
+BENCHMARK_TEMPLATE(BM_HandleRing, TablePolicy, 32);
+BENCHMARK_TEMPLATE(BM_HandleRing, TablePolicy, 128);
+
+struct Choice {
+    uint32_t value;
+};
+
+struct FanA;
+struct FanB;
+struct FanC;
+
+template <class Self>
+struct FanState {
+    OneOf<TransitionTo<FanA>, TransitionTo<FanB>, TransitionTo<FanC>, Nothing> handle(const Choice& c) const {
+        switch (c.value & 3) {
+        case 0:
+            return TransitionTo<FanA>{};
+        case 1:
+            return TransitionTo<FanB>{};
+        case 2:
+            return TransitionTo<FanC>{};
+        default:
+            return Nothing{};
+        }
+    }
+};
+
+struct FanA : FanState<FanA> {
+};
+
+struct FanB : FanState<FanB> {
+};
+
+struct FanC : FanState<FanC> {
+};
+
+template <class Policy>
+void BM_OneOfFanOut(benchmark::State& state) {
+    BasicStateMachine<Policy, FanA, FanB, FanC> machine;
+    uint32_t value = 0;
+    for (auto _ : state) {
+        machine.handle(Choice{value++});
+        benchmark::DoNotOptimize(machine);
+    }
+    state.SetItemsProcessed(state.iterations());
+}
+
+BENCHMARK_TEMPLATE(BM_OneOfFanOut, DefaultPolicy);
+BENCHMARK_TEMPLATE(BM_OneOfFanOut, TablePolicy);
+
+struct Knock {
+    uint32_t key;
+};
+
+/**
+ * Latches taking a self transition on odd keys, the guard written with Maybe or with If.
+ */
+struct MaybeLatch : ByDefault<Nothing> {
+    using ByDefault::handle;
+
+    Maybe<TransitionTo<MaybeLatch>> handle(const Knock& k) const {
+        if (k.key & 1) {
+            return TransitionTo<MaybeLatch>{};
+        }
+        return Nothing{};
+    }
+};
+
+struct IfLatch : ByDefault<Nothing> {
+    using ByDefault::handle;
+
+    bool matches(const Knock& k) const noexcept {
+        return k.key & 1;
+    }
+
+    If<&IfLatch::matches, TransitionTo<IfLatch>> handle(const Knock&) const {
+        return {};
+    }
+};
+
+template <class Policy, class Latch>
+void BM_Guard(benchmark::State& state) {
+    BasicStateMachine<Policy, Latch> machine;
+    std::mt19937 random{42};
+    std::vector<Knock> knocks(4096);
+    for (auto& knock : knocks) {
+        knock.key = static_cast<uint32_t>(random());
+    }
+    std::size_t i = 0;
+    for (auto _ : state) {
+        machine.handle(knocks[i++ & 4095]);
+        benchmark::DoNotOptimize(machine);
+    }
+    state.SetItemsProcessed(state.iterations());
+}
+
+BENCHMARK_TEMPLATE(BM_Guard, DefaultPolicy, MaybeLatch);
+BENCHMARK_TEMPLATE(BM_Guard, DefaultPolicy, IfLatch);
+BENCHMARK_TEMPLATE(BM_Guard, TablePolicy, MaybeLatch);
+BENCHMARK_TEMPLATE(BM_Guard, TablePolicy, IfLatch);
+
+using DoorEvent = std::variant<OpenEvent, CloseEvent, LockEvent, UnlockEvent>;
+
+struct HotVisitPolicy : DefaultPolicy {
+    using Dispatch = HotPathDispatch<VisitDispatch, Hot<OpenState, CloseEvent>, Hot<ClosedState, OpenEvent>>;
+};
+
+struct HotTablePolicy : TablePolicy {
+    using Dispatch = HotPathDispatch<TableDispatch, Hot<OpenState, CloseEvent>, Hot<ClosedState, OpenEvent>>;
+};
+
+/**
+ * Skewed traffic: the door mostly opens and closes, and is locked and unlocked in about 5% of
+ * the iterations, at random.
+ */
+template <class Policy>
+void BM_SkewedTraffic(benchmark::State& state) {
+    BasicDoor<Policy> machine{ClosedState{}, OpenState{}, LockedState{1}};
+    std::mt19937 random{42};
+    std::vector<std::uint8_t> rare(std::size_t{1} << 16);
+    for (auto& flag : rare) {
+        flag = random() % 20 == 0;
+    }
+    std::size_t i = 0;
+    for (auto _ : state) {
+        machine.handle(OpenEvent{});
+        machine.handle(CloseEvent{});
+        if (rare[i++ & (rare.size() - 1)]) {
+            machine.handle(LockEvent{1});
+            machine.handle(UnlockEvent{1});
+        }
+        benchmark::DoNotOptimize(machine);
+    }
+    state.SetItemsProcessed(2 * state.iterations());
+}
+
+BENCHMARK_TEMPLATE(BM_SkewedTraffic, DefaultPolicy);
+BENCHMARK_TEMPLATE(BM_SkewedTraffic, HotVisitPolicy);
+BENCHMARK_TEMPLATE(BM_SkewedTraffic, TablePolicy);
+BENCHMARK_TEMPLATE(BM_SkewedTraffic, HotTablePolicy);
+
+/**
+ * A stream too long for the branch predictors to learn, like the output of a network decoder.
+ */
+std::vector<DoorEvent> randomDoorEvents() {
+    std::mt19937 random{42};
+    std::vector<DoorEvent> events(std::size_t{1} << 20);
+    for (auto& event : events) {
+        switch (random() & 3) {
+        case 0:
+            event = OpenEvent{};
+            break;
+        case 1:
+            event = CloseEvent{};
+            break;
+        case 2:
+            event = LockEvent{1};
+            break;
+        default:
+            event = UnlockEvent{1};
+            break;
+        }
+    }
+    return events;
+}
+
+/**
+ * Decoded events handled by visiting the variant, then the state, or with one table lookup.
+ */
+template <class Machine>
+void BM_VisitVariant(benchmark::State& state) {
+    Machine machine{ClosedState{}, OpenState{}, LockedState{1}};
+    const auto events = randomDoorEvents();
+    std::size_t i = 0;
+    for (auto _ : state) {
+        std::visit([&machine](const auto& event) { machine.handle(event); }, events[i++ & (events.size() - 1)]);
+        benchmark::DoNotOptimize(machine);
+    }
+    state.SetItemsProcessed(state.iterations());
+}
+
+template <class Machine>
+void BM_HandleVariant(benchmark::State& state) {
+    Machine machine{ClosedState{}, OpenState{}, LockedState{1}};
+    const auto events = randomDoorEvents();
+    std::size_t i = 0;
+    for (auto _ : state) {
+        machine.handleVariant(events[i++ & (events.size() - 1)]);
+        benchmark::DoNotOptimize(machine);
+    }
+    state.SetItemsProcessed(state.iterations());
+}
+
+BENCHMARK_TEMPLATE(BM_VisitVariant, Door);
+BENCHMARK_TEMPLATE(BM_HandleVariant, Door);
+BENCHMARK_TEMPLATE(BM_VisitVariant, TableDoor);
+BENCHMARK_TEMPLATE(BM_HandleVariant, TableDoor);
+
+/**
+ * A 256-byte market data frame, copied into an event struct or read through a view.
+ */
+struct QuoteEvent {
+    uint64_t sequence;
+    std::byte body[248];
+};
+
+struct QuoteView : EventView {
+    using EventView::EventView;
+
+    uint64_t sequence() const {
+        return field<uint64_t, 0>();
+    }
+};
+
+struct Quoting : Will<ByDefault<Nothing>, On<QuoteEvent, TransitionTo<Quoting>>,
+                      On<QuoteView, TransitionTo<Quoting>>> {
+    uint64_t last = 0;
+
+    void onEnter(const QuoteEvent& quote) {
+        last = quote.sequence;
+    }
+
+    void onEnter(const QuoteView& quote) {
+        last = quote.sequence();
+    }
+};
+
+template <class Quote>
+void BM_HandleFrame(benchmark::State& state) {
+    StateMachine<Quoting> machine;
+    std::vector<std::byte> frames(sizeof(QuoteEvent) * 64);
+    std::size_t i = 0;
+    for (auto _ : state) {
+        const span<const std::byte> frame(frames.data() + (i++ & 63) * sizeof(QuoteEvent), sizeof(QuoteEvent));
+        machine.handleTagged<Quote>(0, frame);
+        benchmark::DoNotOptimize(machine);
+    }
+    state.SetItemsProcessed(state.iterations());
+}
+
+BENCHMARK_TEMPLATE(BM_HandleFrame, QuoteEvent);
+BENCHMARK_TEMPLATE(BM_HandleFrame, QuoteView);
+
+using DoorRecorder = Recorder<OpenEvent, CloseEvent, LockEvent, UnlockEvent>;
+
+struct RecordedPolicy : TablePolicy {
+    using Observer = DoorRecorder;
+};
+
+/**
+ * Replays a recorded stream of random door events, as a stand-in for a captured day of traffic.
+ */
+void BM_Replay(benchmark::State& state) {
+    const auto events = randomDoorEvents();
+    std::vector<std::uint64_t> region(events.size() * 3);
+    EventLog log{span<std::byte>(reinterpret_cast<std::byte*>(region.data()), region.size() * sizeof(std::uint64_t))};
+    DoorRecorder::attach(&log);
+    BasicDoor<RecordedPolicy> recorded{ClosedState{}, OpenState{}, LockedState{1}};
+    for (const auto& event : events) {
+        std::visit([&recorded](const auto& e) { recorded.handle(e); }, event);
+    }
+    DoorRecorder::attach(nullptr);
+    Replayer<OpenEvent, CloseEvent, LockEvent, UnlockEvent> replayer;
+    replayer.open(log.bytes());
+    TableDoor machine{ClosedState{}, OpenState{}, LockedState{1}};
+    for (auto _ : state) {
+        replayer.replay(machine);
+        benchmark::DoNotOptimize(machine);
+    }
+    state.SetItemsProcessed(state.iterations() * static_cast<std::int64_t>(replayer.count()));
+    state.SetBytesProcessed(state.iterations() * static_cast<std::int64_t>(log.bytes().size()));
+}
+
+BENCHMARK(BM_Replay);
+
+struct Reading {
+    int level;
+};
+
+struct LatestReading {
+    int level;
+};
+
+}  // namespace
+}  // namespace bench
+
+template <>
+struct fsm::queue_traits<bench::LatestReading> {
+    static constexpr queue_mode mode = queue_mode::coalesce_latest;
+};
+
+namespace bench {
+namespace {
+
+struct Gauge : Will<ByDefault<Nothing>, On<Reading, TransitionTo<Gauge>>, On<LatestReading, TransitionTo<Gauge>>> {
+};
+
+using GaugeQueue = QueuedMachine<StateMachine<Gauge>, Reading, LatestReading>;
+
+/**
+ * Every iteration posts a burst of 1024 readings, then drains the queue: coalesced readings
+ * reach the machine once per burst.
+ */
+template <class Event>
+void BM_QueuedBurst(benchmark::State& state) {
+    GaugeQueue queue(1024);
+    for (auto _ : state) {
+        for (int level = 0; level < 1024; ++level) {
+            queue.post(Event{level});
+        }
+        benchmark::DoNotOptimize(queue.drain());
+    }
+    state.SetItemsProcessed(1024 * state.iterations());
+}
+
+BENCHMARK_TEMPLATE(BM_QueuedBurst, Reading);
+BENCHMARK_TEMPLATE(BM_QueuedBurst, LatestReading);
+
+struct Flip {
+};
+
+struct PlainPing;
+struct PlainPong;
+
+struct PlainPing : On<Flip, TransitionTo<PlainPong>> {
+};
+
+struct PlainPong : On<Flip, TransitionTo<PlainPing>> {
+};
+
+struct HookedPing;
+struct HookedPong;
+
+struct HookedPing : On<Flip, TransitionTo<HookedPong>> {
+    void onEnter(const Flip&) {
+        ++entered;
+    }
+
+    void onLeave(const Flip&) {
+        ++left;
+    }
+
+    uint64_t entered = 0;
+    uint64_t left = 0;
+};
+
+struct HookedPong : On<Flip, TransitionTo<HookedPing>> {
+    void onEnter(const Flip&) {
+        ++entered;
+    }
+
+    void onLeave(const Flip&) {
+        ++left;
+    }
+
+    uint64_t entered = 0;
+    uint64_t left = 0;
+};
+
+template <class Policy, class Ping, class Pong>
+void BM_TransitionTo(benchmark::State& state) {
+    BasicStateMachine<Policy, Ping, Pong> machine;
+    for (auto _ : state) {
+        machine.handle(Flip{});
+        benchmark::DoNotOptimize(machine);
+    }
+    state.SetItemsProcessed(state.iterations());
+}
+
+BENCHMARK_TEMPLATE(BM_TransitionTo, DefaultPolicy, PlainPing, PlainPong);
+BENCHMARK_TEMPLATE(BM_TransitionTo, DefaultPolicy, HookedPing, HookedPong);
+BENCHMARK_TEMPLATE(BM_TransitionTo, TablePolicy, PlainPing, PlainPong);
+BENCHMARK_TEMPLATE(BM_TransitionTo, TablePolicy, HookedPing, HookedPong);
+
+struct HistogramPolicy : TablePolicy {
+    using Observer = HistogramObserver<2, Flip>;
+};
+
+template <class Policy, class Ping, class Pong>
+void BM_TransitionProfiled(benchmark::State& state) {
+    Policy::Observer::prepare();
+    BM_TransitionTo<Policy, Ping, Pong>(state);
+}
+
+BENCHMARK_TEMPLATE(BM_TransitionProfiled, HistogramPolicy, PlainPing, PlainPong);
+BENCHMARK_TEMPLATE(BM_TransitionProfiled, HistogramPolicy, HookedPing, HookedPong);
+
+struct SeqlockPolicy : TablePolicy {
+    using Concurrency = SeqlockReads;
+};
+
+BENCHMARK_TEMPLATE(BM_TransitionTo, SeqlockPolicy, PlainPing, PlainPong);
+BENCHMARK_TEMPLATE(BM_TransitionTo, SeqlockPolicy, HookedPing, HookedPong);
+
+/**
+ * The driver thread flips the machine while another thread polls its state.
+ */
+void BM_TransitionPolled(benchmark::State& state) {
+    BasicStateMachine<SeqlockPolicy, PlainPing, PlainPong> machine;
+    std::atomic<bool> done{false};
+    std::thread monitor([&machine, &done] {
+        while (!done.load(std::memory_order_relaxed)) {
+            benchmark::DoNotOptimize(machine.currentIndex());
+            machine.tryReadState<PlainPong>([](const PlainPong& pong) { benchmark::DoNotOptimize(&pong); });
+        }
+    });
+    for (auto _ : state) {
+        machine.handle(Flip{});
+        benchmark::DoNotOptimize(machine);
+    }
+    done.store(true);
+    monitor.join();
+    state.SetItemsProcessed(state.iterations());
+}
+
+BENCHMARK(BM_TransitionPolled);
+
+/**
+ * The same flips through the runtime table of a DynamicMachine, as loaded from a plugin.
+ */
+template <class Policy, class Ping, class Pong>
+void BM_DynamicTransition(benchmark::State& state) {
+    static const machine_abi abi = make_machine_abi<BasicStateMachine<Policy, Ping, Pong>, Flip>();
+    DynamicMachine<Flip> machine{abi};
+    for (auto _ : state) {
+        machine.handle(Flip{});
+        benchmark::DoNotOptimize(machine);
+    }
+    state.SetItemsProcessed(state.iterations());
+}
+
+BENCHMARK_TEMPLATE(BM_DynamicTransition, TablePolicy, PlainPing, PlainPong);
+BENCHMARK_TEMPLATE(BM_DynamicTransition, TablePolicy, HookedPing, HookedPong);
+
+/**
+ * Baseline with one virtual call per hop, each state returning the next one.
+ */
+struct VirtualState {
+    virtual ~VirtualState() = default;
+    virtual VirtualState* handle(const Flip&) = 0;
+};
+
+struct VirtualHop final : VirtualState {
+    VirtualState* handle(const Flip&) override {
+        ++entered;
+        return next;
+    }
+
+    VirtualState* next = nullptr;
+    uint64_t entered = 0;
+};
+
+void BM_VirtualTransition(benchmark::State& state) {
+    VirtualHop ping;
+    VirtualHop pong;
+    ping.next = &pong;
+    pong.next = &ping;
+    VirtualState* current = &ping;
+    for (auto _ : state) {
+        current = current->handle(Flip{});
+        benchmark::DoNotOptimize(current);
+    }
+    state.SetItemsProcessed(state.iterations());
+}
+
+BENCHMARK(BM_VirtualTransition);
+
+template <class Machine>
+void BM_CopyMachine(benchmark::State& state) {
+    Machine source{ClosedState{}, OpenState{}, LockedState{1}};
+    source.handle(LockEvent{2});
+    for (auto _ : state) {
+        Machine copy{source};
+        benchmark::DoNotOptimize(copy);
+    }
+}
+
+template <class Machine>
+void BM_MoveMachine(benchmark::State& state) {
+    Machine source{ClosedState{}, OpenState{}, LockedState{1}};
+    source.handle(LockEvent{2});
+    for (auto _ : state) {
+        Machine moved{std::move(source)};
+        benchmark::DoNotOptimize(moved);
+        source = std::move(moved);
+    }
+}
+
+BENCHMARK_TEMPLATE(BM_CopyMachine, Door);
+BENCHMARK_TEMPLATE(BM_CopyMachine, TableDoor);
+BENCHMARK_TEMPLATE(BM_MoveMachine, Door);
+BENCHMARK_TEMPLATE(BM_MoveMachine, TableDoor);
+
+struct PowerUp {
+};
+
+struct PowerDown {
+};
+
+struct Powered;
+
+struct Unpowered : On<PowerUp, TransitionTo<Powered>>, ByDefault<Nothing> {
+    using On::handle;
+    using ByDefault::handle;
+};
+
+struct Powered : On<PowerDown, TransitionTo<Unpowered>>, ByDefault<Nothing> {
+    using On::handle;
+    using ByDefault::handle;
+};
+
+using Power = StateMachine<Unpowered, Powered>;
+
+// Door events reach one region out of three.
+void BM_SeparateRegions(benchmark::State& state) {
+    Power power;
+    Door door;
+    Power backup;
+    for (auto _ : state) {
+        power.handle(OpenEvent{});
+        door.handle(OpenEvent{});
+        backup.handle(OpenEvent{});
+        power.handle(CloseEvent{});
+        door.handle(CloseEvent{});
+        backup.handle(CloseEvent{});
+        benchmark::DoNotOptimize(door);
+    }
+    state.SetItemsProcessed(2 * state.iterations());
+}
+
+void BM_ParallelRegions(benchmark::State& state) {
+    Parallel<Power, Door, Power> device;
+    for (auto _ : state) {
+        device.handle(OpenEvent{});
+        device.handle(CloseEvent{});
+        benchmark::DoNotOptimize(device);
+    }
+    state.SetItemsProcessed(2 * state.iterations());
+}
+
+BENCHMARK(BM_SeparateRegions);
+BENCHMARK(BM_ParallelRegions);
+
+std::vector<std::size_t> randomIds(std::size_t machines) {
+    std::vector<std::size_t> ids(4096);
+    std::mt19937_64 random{42};
+    std::uniform_int_distribution<std::size_t> distribution{0, machines - 1};
+    for (auto& id : ids) {
+        id = distribution(random);
+    }
+    return ids;
+}
+
+template <class Machine>
+void BM_FleetThroughput(benchmark::State& state) {
+    const auto machines = static_cast<std::size_t>(state.range(0));
+    std::vector<Machine> fleet(machines, Machine{ClosedState{}, OpenState{}, LockedState{1}});
+    const auto ids = randomIds(machines);
+    std::size_t i = 0;
+    for (auto _ : state) {
+        Machine& machine = fleet[ids[i++ & 4095]];
+        machine.handle(OpenEvent{});
+        machine.handle(CloseEvent{});
+        benchmark::DoNotOptimize(machine);
+    }
+    state.SetItemsProcessed(2 * state.iterations());
+}
+
+/**
+ * Broadcast closing every door of the pool, a third of them open, serially or in parallel
+ * chunks; items are machines.
+ */
+template <bool Parallel>
+void BM_PoolBroadcast(benchmark::State& state) {
+    const auto machines = static_cast<std::size_t>(state.range(0));
+    MachinePool<ClosedState, OpenState, LockedState> pool{ClosedState{}, OpenState{}, LockedState{1}};
+    pool.reserve(machines);
+    for (std::size_t m = 0; m < machines; ++m) {
+        pool.add();
+    }
+    for (auto _ : state) {
+        state.PauseTiming();
+        for (std::size_t m = 0; m < machines; m += 3) {
+            pool.transitionTo<OpenState>(m);
+        }
+        state.ResumeTiming();
+        if constexpr (Parallel) {
+            pool.handleAll(std::execution::par_unseq, CloseEvent{});
+        } else {
+            pool.handleAll(CloseEvent{});
+        }
+        benchmark::DoNotOptimize(pool);
+    }
+    state.SetItemsProcessed(static_cast<int64_t>(machines) * state.iterations());
+}
+
+void BM_PoolThroughput(benchmark::State& state) {
+    const auto machines = static_cast<std::size_t>(state.range(0));
+    MachinePool<ClosedState, OpenState, LockedState> pool{ClosedState{}, OpenState{}, LockedState{1}};
+    pool.reserve(machines);
+    for (std::size_t m = 0; m < machines; ++m) {
+        pool.add();
+    }
+    const auto ids = randomIds(machines);
+    std::size_t i = 0;
+    for (auto _ : state) {
+        const auto id = ids[i++ & 4095];
+        pool.handle(id, OpenEvent{});
+        pool.handle(id, CloseEvent{});
+        benchmark::DoNotOptimize(pool);
+    }
+    state.SetItemsProcessed(2 * state.iterations());
+}
+
+struct Touch {
+};
+
+struct IdleSession;
+
+struct ActiveSession : Will<ByDefault<Nothing>, On<Touch, TransitionTo<ActiveSession>>,
+                            After<timeout_seconds<30>, TransitionTo<IdleSession>>> {
+};
+
+struct IdleSession : Will<ByDefault<Nothing>, On<Touch, TransitionTo<ActiveSession>>> {
+};
+
+/**
+ * Every iteration touches one session, re-arming its timer, and advances the clock by one
+ * millisecond; sessions touched 30s earlier and not since time out.
+ */
+void BM_PoolTimeouts(benchmark::State& state) {
+    const auto machines = static_cast<std::size_t>(state.range(0));
+    MachinePool<IdleSession, ActiveSession> pool;
+    pool.reserve(machines);
+    for (std::size_t m = 0; m < machines; ++m) {
+        pool.add();
+    }
+    const auto ids = randomIds(machines);
+    std::size_t i = 0;
+    std::chrono::milliseconds now{0};
+    for (auto _ : state) {
+        pool.handle(ids[i++ & 4095], Touch{});
+        benchmark::DoNotOptimize(pool.tick(++now));
+    }
+    state.SetItemsProcessed(state.iterations());
+}
+
+/**
+ * Every iteration moves one partition of range(0) machines to the other node and back, with an
+ * event pending during each handoff.
+ */
+void BM_MigratePartition(benchmark::State& state) {
+    using Pool = MachinePool<ClosedState, OpenState, LockedState>;
+    using Node = PartitionNode<Pool, OpenEvent, CloseEvent, LockEvent, UnlockEvent>;
+    const auto machines = static_cast<std::size_t>(state.range(0));
+    PartitionMap map(machines);
+    map.addNode(0);
+    Pool first{ClosedState{}, OpenState{}, LockedState{1}};
+    Pool second{ClosedState{}, OpenState{}, LockedState{1}};
+    Node nodes[] = {Node{map, 0, first}, Node{map, 1, second}};
+    nodes[0].claim(machines);
+    std::vector<std::byte> block(nodes[0].blockSize(0) + 64);
+    std::size_t from = 0;
+    for (auto _ : state) {
+        for (int move = 0; move < 2; ++move) {
+            Node& source = nodes[from];
+            Node& target = nodes[from ^ 1];
+            source.beginHandoff(0);
+            target.expect(0);
+            source.handle(machines / 2, OpenEvent{});
+            const std::size_t size = source.extract(0, span<std::byte>(block.data(), block.size()));
+            target.adopt(span<const std::byte>(block.data(), size));
+            from ^= 1;
+        }
+        benchmark::DoNotOptimize(block.data());
+    }
+    state.SetItemsProcessed(2 * state.iterations() * static_cast<std::int64_t>(machines));
+    state.SetBytesProcessed(2 * state.iterations() * static_cast<std::int64_t>(nodes[0].blockSize(0)));
+}
+
+BENCHMARK_TEMPLATE(BM_FleetThroughput, Door)->RangeMultiplier(16)->Range(1 << 8, 1 << 20);
+BENCHMARK_TEMPLATE(BM_FleetThroughput, TableDoor)->RangeMultiplier(16)->Range(1 << 8, 1 << 20);
+BENCHMARK_TEMPLATE(BM_PoolBroadcast, false)->RangeMultiplier(16)->Range(1 << 12, 1 << 22)->UseRealTime();
+BENCHMARK_TEMPLATE(BM_PoolBroadcast, true)->RangeMultiplier(16)->Range(1 << 12, 1 << 22)->UseRealTime();
+BENCHMARK(BM_PoolThroughput)->RangeMultiplier(16)->Range(1 << 8, 1 << 20);
+BENCHMARK(BM_PoolTimeouts)->RangeMultiplier(16)->Range(1 << 8, 1 << 20);
+BENCHMARK(BM_MigratePartition)->RangeMultiplier(16)->Range(1 << 8, 1 << 20);
+
+}  // namespace
+}  // namespace bench
+
+BENCHMARK_MAIN();
@@ -0,0 +1,121 @@
+#!/usr/bin/env python3
+"""Generate and measure a stress machine of N states and M events.
+
+generate: writes a C++ source defining states S0..S(N-1) and events E0..E(M-1),
+          each state reacting to a subset of the events, and a main() that
+          pushes every event type through the machine.
+measure:  generates the source for each dispatch policy, compiles it, and
+          writes compile time and binary size (as built and stripped) as JSON.
+"""
+
+import argparse
+import json
+import os
+import subprocess
+import sys
+import tempfile
+import time
+
+POLICIES = {
+    'visit': 'fsm::DefaultPolicy',
+    'table': 'StressTablePolicy',
+}
+
+
+def generate(states, events, policy):
+    lines = [
+        '#include <cstdint>',
+        '#include <cstdio>',
+        '',
+        '#include <fsm/actions/ByDefault.hpp>',
+        '#include <fsm/actions/Nothing.hpp>',
+        '#include <fsm/actions/On.hpp>',
+        '#include <fsm/actions/TransitionTo.hpp>',
+        '#include <fsm/actions/Will.hpp>',
+        '#include <fsm/StateMachine.hpp>',
+        '',
+        'struct StressTablePolicy : fsm::DefaultPolicy {',
+        '    using Dispatch = fsm::TableDispatch;',
+        '    using Storage = fsm::IndexStorage;',
+        '};',
+        '',
+    ]
+    lines += ['struct E%d {\n};\n' % e for e in range(events)]
+    lines += ['struct S%d;' % s for s in range(states)]
+    lines.append('')
+    for s in range(states):
+        handlers = ['fsm::ByDefault<fsm::Nothing>']
+        for e in range(s % 4, events, 4):
+            handlers.append('fsm::On<E%d, fsm::TransitionTo<S%d>>' % (e, (s + e + 1) % states))
+        lines.append('struct S%d : fsm::Will<%s> {\n};\n' % (s, ',\n    '.join(handlers)))
+    lines.append('using StressMachine = fsm::BasicStateMachine<%s, %s>;\n'
+                 % (POLICIES[policy], ', '.join('S%d' % s for s in range(states))))
+    lines.append('int main(int argc, char**) {')
+    lines.append('    StressMachine machine;')
+    lines.append('    for (int round = 0; round < argc * 1000; ++round) {')
+    lines += ['        machine.handle(E%d{});' % e for e in range(events)]
+    lines.append('    }')
+    lines.append('    return 0;')
+    lines.append('}')
+    return '\n'.join(lines) + '\n'
+
+
+def measure(args):
+    results = []
+    with tempfile.TemporaryDirectory() as work:
+        for policy in POLICIES:
+            source = os.path.join(work, 'stress_%s.cpp' % policy)
+            binary = os.path.join(work, 'stress_%s' % policy)
+            with open(source, 'w') as out:
+                out.write(generate(args.states, args.events, policy))
+            command = args.cxx + ['-std=c++17', '-O2', '-I', args.include, source, '-o', binary]
+            start = time.monotonic()
+            subprocess.run(command, check=True)
+            elapsed = time.monotonic() - start
+            size = os.path.getsize(binary)
+            subprocess.run(['strip', binary], check=True)
+            results.append({
+                'name': 'stress_%s/%dx%d' % (policy, args.states, args.events),
+                'states': args.states,
+                'events': args.events,
+                'policy': policy,
+                'compile_seconds': round(elapsed, 3),
+                'binary_bytes': size,
+                'stripped_bytes': os.path.getsize(binary),
+            })
+    report = json.dumps({'benchmarks': results}, indent=2)
+    if args.output:
+        with open(args.output, 'w') as out:
+            out.write(report + '\n')
+    print(report)
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__, formatter_class=argparse.RawDescriptionHelpFormatter)
+    parser.add_argument('mode', choices=['generate', 'measure'])
+    parser.add_argument('--states', type=int, default=150)
+    parser.add_argument('--events', type=int, default=80)
+    parser.add_argument('--policy', choices=sorted(POLICIES), default='table')
+    parser.add_argument('--include', default='.', help='directory containing fsm/')
+    parser.add_argument('--output', help='generated source (generate) or JSON report (measure)')
+    parser.epilog = 'measure takes the compiler command line after --, e.g. measure -- g++'
+    argv = sys.argv[1:]
+    split = argv.index('--') if '--' in argv else len(argv)
+    args = parser.parse_args(argv[:split])
+    args.cxx = argv[split + 1:]
+
+    if args.mode == 'generate':
+        source = generate(args.states, args.events, args.policy)
+        if args.output:
+            with open(args.output, 'w') as out:
+                out.write(source)
+        else:
+            sys.stdout.write(source)
+    else:
+        if not args.cxx:
+            parser.error('measure needs the compiler command line')
+        measure(args)
+
+
+if __name__ == '__main__':
+    main()
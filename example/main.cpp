@@ -1,10 +1,15 @@
+#include <cstdint>
+
 #include <fsm/actions/Nothing.hpp>
 #include <fsm/actions/TransitionTo.hpp>
-#include <fsm/actions/Maybe.hpp>
+#include <fsm/actions/If.hpp>
 #include <fsm/actions/ByDefault.hpp>
 #include <fsm/actions/On.hpp>
 #include <fsm/actions/Will.hpp>
 #include <fsm/StateMachine.hpp>
+#include <fsm/tools/TransitionGraph.hpp>
+
+using namespace fsm;
 
 struct OpenEvent
 {
@@ -54,12 +59,14 @@ public:
         key = e.newKey;
     }
 
-    Maybe<TransitionTo<ClosedState>> handle(const UnlockEvent& e) const
+    bool matches(const UnlockEvent& e) const
+    {
+        return e.key == key;
+    }
+
+    If<&LockedState::matches, TransitionTo<ClosedState>> handle(const UnlockEvent&) const
     {
-        if (e.key == key) {
-            return TransitionTo<ClosedState>{};
-        }
-        return Nothing{};
+        return {};
     }
 
 private:
@@ -68,6 +75,16 @@ private:
 
 using Door = StateMachine<ClosedState, OpenState, LockedState>;
 
+static_assert(reachable_states<Door, OpenEvent, CloseEvent, LockEvent, UnlockEvent>()[Door::state_id<LockedState>]);
+
+struct FastPolicy : DefaultPolicy
+{
+    using Dispatch = TableDispatch;
+    using Storage = IndexStorage;
+};
+
+using FastDoor = BasicStateMachine<FastPolicy, ClosedState, OpenState, LockedState>;
+
 int main()
 {
     Door door{ClosedState{}, OpenState{}, LockedState{0x11}};
@@ -76,5 +93,11 @@ int main()
     door.handle(UnlockEvent{2});
     door.handle(UnlockEvent{1234});
 
+    FastDoor fastDoor{ClosedState{}, OpenState{}, LockedState{0x11}};
+
+    fastDoor.handle(LockEvent{1234});
+    fastDoor.handle(UnlockEvent{2});
+    fastDoor.handle(UnlockEvent{1234});
+
     return 0;
 }
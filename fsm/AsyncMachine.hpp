@@ -0,0 +1,322 @@
+#pragma once
+
+#if defined(__cpp_impl_coroutine) && __cpp_impl_coroutine >= 201902L && __has_include(<coroutine>)
+#define FSM_HAS_COROUTINES 1
+#else
+#define FSM_HAS_COROUTINES 0
+#endif
+
+#if FSM_HAS_COROUTINES
+
+#include <coroutine>
+#include <cstddef>
+#include <deque>
+#include <exception>
+#include <optional>
+#include <utility>
+#include <variant>
+
+#include "policies/Observer.hpp"
+#include "tools/TypeIndex.hpp"
+
+namespace fsm {
+
+/**
+ * @brief Coroutine returned by an onEnter hook which waits on I/O.
+ * @details The coroutine is lazy: the AsyncMachine entering the state starts it once the
+ * transition is complete, and is told when it finishes, on whichever thread resumes it last.
+ * @code
+ * struct Fetching {
+ *     fsm::Task onEnter(const Fetch& fetch) {
+ *         body = co_await http.get(fetch.url);
+ *     }
+ * };
+ * @endcode
+ */
+class Task {
+public:
+    static constexpr bool suspends_machine = true;
+
+    struct promise_type;
+
+    using handle_type = std::coroutine_handle<promise_type>;
+
+    struct promise_type {
+        Task get_return_object() noexcept {
+            return Task{handle_type::from_promise(*this)};
+        }
+
+        std::suspend_always initial_suspend() noexcept {
+            return {};
+        }
+
+        auto final_suspend() noexcept {
+            struct final_awaiter {
+                bool await_ready() noexcept {
+                    return false;
+                }
+
+                void await_suspend(handle_type handle) noexcept {
+                    // The callback may destroy the frame: nothing touches it afterwards.
+                    promise_type& promise = handle.promise();
+                    promise.onDone(promise.owner);
+                }
+
+                void await_resume() noexcept {
+                }
+            };
+            return final_awaiter{};
+        }
+
+        void return_void() noexcept {
+        }
+
+        void unhandled_exception() noexcept {
+            exception = std::current_exception();
+        }
+
+        void (*onDone)(void*) noexcept = nullptr;
+        void* owner = nullptr;
+        std::exception_ptr exception;
+    };
+
+    Task(Task&& other) noexcept : handle(std::exchange(other.handle, {})) {
+    }
+
+    Task& operator=(Task&& other) noexcept {
+        if (this != &other) {
+            reset();
+            handle = std::exchange(other.handle, {});
+        }
+        return *this;
+    }
+
+    Task(const Task&) = delete;
+    Task& operator=(const Task&) = delete;
+
+    ~Task() {
+        reset();
+    }
+
+    /**
+     * @brief Run the coroutine up to its first suspension; onDone(owner) is called when it
+     * completes.
+     */
+    void start(void (*onDone)(void*) noexcept, void* owner) {
+        handle.promise().onDone = onDone;
+        handle.promise().owner = owner;
+        // onDone may destroy this Task before resume() returns.
+        const handle_type started = handle;
+        started.resume();
+    }
+
+    /**
+     * @brief Exception which escaped the completed coroutine, if any.
+     */
+    std::exception_ptr exception() const noexcept {
+        return handle.promise().exception;
+    }
+
+private:
+    explicit Task(handle_type handle) noexcept : handle(handle) {
+    }
+
+    void reset() noexcept {
+        if (handle) {
+            handle.destroy();
+            handle = {};
+        }
+    }
+
+    handle_type handle;
+};
+
+/**
+ * @brief Awaitable resuming the awaiting coroutine through executor.execute, e.g. to get back
+ * to the thread driving the machine after I/O completed on another one.
+ */
+template <typename Executor>
+auto resume_on(Executor& executor) noexcept {
+    struct awaiter {
+        Executor& executor;
+
+        bool await_ready() const noexcept {
+            return false;
+        }
+
+        void await_suspend(std::coroutine_handle<> handle) {
+            executor.execute([handle] { handle.resume(); });
+        }
+
+        void await_resume() const noexcept {
+        }
+    };
+    return awaiter{executor};
+}
+
+/**
+ * @brief Machine whose onEnter hooks may be coroutines, available with C++20 coroutines only.
+ * @details An onEnter hook returning fsm::Task suspends the machine once the transition is
+ * complete: events handled meanwhile are queued, in order, and the thread calling handle() is
+ * never blocked. When the coroutine finishes, the machine resumes through
+ * executor.execute(callback), which runs the queued events. The executor decides where the
+ * machine resumes and has to run callbacks on the thread driving the machine, or otherwise
+ * serialize them with handle(). An exception escaping the coroutine, or thrown by execute when
+ * it completes, is rethrown by the next handle(); destroying the machine destroys the coroutine
+ * in flight.
+ * @tparam Machine : wrapped BasicStateMachine.
+ * @tparam Executor : type with execute(f), running the callable f later.
+ * @tparam Events : events that can be queued.
+ */
+template <class Machine, class Executor, class... Events>
+class AsyncMachine {
+public:
+    using event_type = std::variant<Events...>;
+    using observer_type = observer_of_t<Machine>;
+
+    template <typename State>
+    static constexpr std::size_t state_id = Machine::template state_id<State>;
+
+    /**
+     * @param[in] executor : executor resuming the machine, must outlive it.
+     * @param[in] args : arguments forwarded to the constructor of the machine.
+     */
+    template <typename... Args>
+    explicit AsyncMachine(Executor& executor, Args&&... args)
+        : executor(executor), inner(std::forward<Args>(args)...) {
+    }
+
+    // Running coroutines point back to the machine.
+    AsyncMachine(const AsyncMachine&) = delete;
+    AsyncMachine& operator=(const AsyncMachine&) = delete;
+
+    template <typename Event>
+    void handle(const Event& event) {
+        static_assert(type_index_v<Event, Events...> < sizeof...(Events), "event not listed in AsyncMachine");
+        if (failure) {
+            std::rethrow_exception(std::exchange(failure, {}));
+        }
+        if (running || current || !queue.empty()) {
+            queue.emplace_back(std::in_place_type<Event>, event);
+            if (!running && !current) {
+                running_guard guard{running};
+                settle();
+            }
+            return;
+        }
+        running_guard guard{running};
+        dispatch(event);
+        settle();
+    }
+
+    /**
+     * @brief Whether an onEnter coroutine is in flight.
+     */
+    bool suspended() const noexcept {
+        return static_cast<bool>(current);
+    }
+
+    std::size_t pending() const noexcept {
+        return queue.size();
+    }
+
+    Machine& machine() noexcept {
+        return inner;
+    }
+
+    const Machine& machine() const noexcept {
+        return inner;
+    }
+
+    template <typename State>
+    State& transitionTo() noexcept {
+        return inner.template transitionTo<State>();
+    }
+
+    /**
+     * @brief Called by TransitionTo with the coroutine of the onEnter hook of the new state.
+     */
+    void suspendOn(Task&& task) noexcept {
+        next = std::move(task);
+    }
+
+private:
+    struct running_guard {
+        explicit running_guard(bool& running) noexcept : running(running) {
+            running = true;
+        }
+
+        ~running_guard() {
+            running = false;
+        }
+
+        bool& running;
+    };
+
+    template <typename Event>
+    void dispatch(const Event& event) {
+        inner.handleBy(event, *this);
+    }
+
+    /**
+     * @brief Start the coroutine of the last transition, then handle queued events until one
+     * suspends the machine again; called with running set.
+     */
+    void settle() {
+        for (;;) {
+            if (next) {
+                current = std::move(next);
+                next.reset();
+                current->start(&AsyncMachine::completed, this);
+                if (current) {
+                    return;
+                }
+            }
+            if (queue.empty() || failure) {
+                return;
+            }
+            event_type event = std::move(queue.front());
+            queue.pop_front();
+            std::visit([this](const auto& queued) { dispatch(queued); }, event);
+        }
+    }
+
+    /**
+     * @brief Called from the final suspension of the coroutine, hence noexcept: when execute
+     * throws, the coroutine is dropped and its exception, or else the one of execute, is
+     * rethrown by the next handle().
+     */
+    static void completed(void* self) noexcept {
+        auto& machine = *static_cast<AsyncMachine*>(self);
+        try {
+            machine.executor.execute([&machine] { machine.resume(); });
+        } catch (...) {
+            machine.failure = machine.current->exception();
+            if (!machine.failure) {
+                machine.failure = std::current_exception();
+            }
+            machine.current.reset();
+        }
+    }
+
+    void resume() {
+        failure = current->exception();
+        current.reset();
+        if (!running) {
+            running_guard guard{running};
+            settle();
+        }
+    }
+
+    Executor& executor;
+    Machine inner;
+    std::deque<event_type> queue;
+    std::optional<Task> current;
+    std::optional<Task> next;
+    std::exception_ptr failure;
+    bool running = false;
+};
+
+}  // End of namespace fsm
+
+#endif
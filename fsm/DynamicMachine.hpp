@@ -0,0 +1,353 @@
+#pragma once
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <new>
+#include <stdexcept>
+#include <tuple>
+#include <type_traits>
+#include <utility>
+
+#include "policies/Observer.hpp"
+#include "tools/StateTraits.hpp"
+#include "tools/TypeIndex.hpp"
+
+namespace fsm {
+
+template <class Policy, class... States>
+class BasicStateMachine;
+
+/**
+ * @brief Version of machine_abi, bumped whenever its layout changes.
+ */
+constexpr std::uint32_t machine_abi_version = 1;
+
+/**
+ * @brief Flat runtime table of a compiled machine, the interface between a DynamicMachine and
+ * the library defining the machine.
+ * @details Only fixed-size integers, pointers and function pointers, so that a host and a
+ * plugin built separately agree on it. States and events are numbered as in the machine (see
+ * state_id) and in the list of events the table was made for; the machine itself is an opaque
+ * object of machine_size bytes, allocated by the host and built by construct.
+ */
+struct machine_abi {
+    /**
+     * @brief Handle the event at address event in state, return the new state.
+     */
+    using handler_fn = std::uint32_t (*)(void* machine, const void* event, std::uint32_t state);
+
+    std::uint32_t version;
+    std::uint32_t state_count;
+    std::uint32_t event_count;
+    std::size_t machine_size;
+    std::size_t machine_align;
+    /// sizeof of every event, event_count entries.
+    const std::size_t* event_sizes;
+    /// Handler of event e in state s at handlers[s * event_count + e].
+    const handler_fn* handlers;
+    /// Machine copied by construct, or nullptr to default construct it.
+    const void* prototype;
+    /// Build a copy of the machine source (or a default one) in storage, return its state.
+    std::uint32_t (*construct)(void* storage, const void* source);
+    void (*destroy)(void* machine);
+    /// Transition to state as transitionTo() would, without running any hook; return state.
+    std::uint32_t (*enter)(void* machine, std::uint32_t state);
+};
+
+template <class Machine, class... Events>
+struct machine_abi_of;
+
+/**
+ * @brief Compile-time generated machine_abi of a BasicStateMachine for a list of events.
+ * @details The handler of every (state, event) pair runs the action returned by the state
+ * inline, as the table dispatch does, and pairs where the state does not react share an entry
+ * that leaves the state unchanged without touching the machine. Machines whose policy runs to
+ * completion or publishes the state go through handle(), to keep queueing and write sections.
+ */
+template <class Policy, class... States, class... Events>
+struct machine_abi_of<BasicStateMachine<Policy, States...>, Events...> {
+    static_assert((std::is_trivially_copyable_v<Events> && ...), "events are shared by layout with the host");
+
+    using machine_type = BasicStateMachine<Policy, States...>;
+
+    template <std::size_t EventInd, std::size_t StateInd>
+    static std::uint32_t dispatchToState(void* object, const void* source, std::uint32_t) {
+        using Event = std::tuple_element_t<EventInd, std::tuple<Events...>>;
+        using State = std::tuple_element_t<StateInd, std::tuple<States...>>;
+        auto& machine = *static_cast<machine_type*>(object);
+        const auto& event = *static_cast<const Event*>(source);
+        if constexpr (Policy::EventQueue::run_to_completion || Policy::Concurrency::publishes_state) {
+            machine.handle(event);
+        } else if constexpr (observes_handling_v<machine_type, Event>) {
+            const handle_scope<machine_type, Event> scope{event};
+            handleInState<State>(machine, event);
+        } else {
+            handleInState<State>(machine, event);
+        }
+        return indexOf(machine);
+    }
+
+    template <typename State, typename Event>
+    static void handleInState(machine_type& machine, const Event& event) {
+        auto& state = machine.template state<State>();
+        notify_dispatch<machine_type, State, Event>(event);
+        auto action = state.handle(event);
+        action.execute(machine, state, event);
+    }
+
+    static std::uint32_t indexOf(const machine_type& machine) noexcept {
+        return static_cast<std::uint32_t>(machine.currentIndex());
+    }
+
+    static std::uint32_t stay(void*, const void*, std::uint32_t state) noexcept {
+        return state;
+    }
+
+    template <std::size_t EventInd, std::size_t StateInd>
+    static constexpr machine_abi::handler_fn entry() {
+        using Event = std::tuple_element_t<EventInd, std::tuple<Events...>>;
+        using State = std::tuple_element_t<StateInd, std::tuple<States...>>;
+        if constexpr (handles_v<State, Event> || is_observed_v<machine_type> || Policy::EventQueue::run_to_completion) {
+            return &dispatchToState<EventInd, StateInd>;
+        } else {
+            return &stay;
+        }
+    }
+
+    template <std::size_t... Idxs>
+    static constexpr std::array<machine_abi::handler_fn, sizeof...(Idxs)> makeHandlers(std::index_sequence<Idxs...>) {
+        return {{entry<Idxs % sizeof...(Events), Idxs / sizeof...(Events)>()...}};
+    }
+
+    constexpr static std::array<machine_abi::handler_fn, sizeof...(States) * sizeof...(Events)> handlers =
+        makeHandlers(std::make_index_sequence<sizeof...(States) * sizeof...(Events)>{});
+
+    constexpr static std::array<std::size_t, sizeof...(Events)> event_sizes = {{sizeof(Events)...}};
+
+    static std::uint32_t construct(void* storage, const void* source) {
+        if (source) {
+            return indexOf(*new (storage) machine_type(*static_cast<const machine_type*>(source)));
+        }
+        if constexpr (std::is_default_constructible_v<machine_type>) {
+            return indexOf(*new (storage) machine_type());
+        } else {
+            throw std::invalid_argument("machine_abi without prototype of a machine not default constructible");
+        }
+    }
+
+    static void destroy(void* machine) {
+        static_cast<machine_type*>(machine)->~machine_type();
+    }
+
+    template <std::size_t StateInd>
+    static std::uint32_t enterState(void* machine) {
+        using State = std::tuple_element_t<StateInd, std::tuple<States...>>;
+        static_cast<machine_type*>(machine)->template transitionTo<State>();
+        return StateInd;
+    }
+
+    template <std::size_t... StateIdxs>
+    static constexpr std::array<std::uint32_t (*)(void*), sizeof...(States)> makeEnterTable(
+        std::index_sequence<StateIdxs...>) {
+        return {{&enterState<StateIdxs>...}};
+    }
+
+    constexpr static std::array<std::uint32_t (*)(void*), sizeof...(States)> enter_table =
+        makeEnterTable(std::index_sequence_for<States...>{});
+
+    static std::uint32_t enter(void* machine, std::uint32_t state) {
+        return enter_table[state](machine);
+    }
+
+    static constexpr machine_abi make(const machine_type* prototype) noexcept {
+        return {machine_abi_version,
+                sizeof...(States),
+                sizeof...(Events),
+                sizeof(machine_type),
+                alignof(machine_type),
+                event_sizes.data(),
+                handlers.data(),
+                prototype,
+                &construct,
+                &destroy,
+                &enter};
+    }
+};
+
+/**
+ * @brief Table of Machine handling Events, to export from a library (see MachinePlugin).
+ * @param[in] prototype : machine copied by every DynamicMachine built from the table, which
+ * has to outlive them; nullptr to default construct them.
+ * @code
+ * FSM_PLUGIN_EXPORT const fsm::machine_abi* fsm_machine() {
+ *     static const Door prototype{ClosedState{}, OpenState{}, LockedState{0}};
+ *     static const fsm::machine_abi abi =
+ *         fsm::make_machine_abi<Door, OpenEvent, CloseEvent, LockEvent, UnlockEvent>(&prototype);
+ *     return &abi;
+ * }
+ * @endcode
+ */
+template <class Machine, class... Events>
+constexpr machine_abi make_machine_abi(const Machine* prototype = nullptr) noexcept {
+    return machine_abi_of<Machine, Events...>::make(prototype);
+}
+
+/**
+ * @brief Machine whose states are only known at runtime, through a machine_abi, e.g. loaded
+ * from a plugin, so that protocol versions can be swapped without rebuilding the host.
+ * @details Handling an event costs one indirect call into the [state][event] table of the
+ * library, like handling it with the table dispatch. The event list of the host is a prefix
+ * of the one of the library: a library built for more events, appended to the host's ones,
+ * loads too, and handleTagged() reaches its extra events. Events are passed by address, so
+ * host and library have to agree on their layout; their sizes are checked on construction.
+ *
+ * Swapping versions builds a new machine, which may carry the state over by number:
+ * @code
+ * const std::size_t state = door.currentIndex();
+ * door = fsm::DynamicMachine<OpenEvent, CloseEvent, LockEvent, UnlockEvent>{v2.abi()};
+ * door.enter(state);
+ * @endcode
+ * A moved-from DynamicMachine can only be destroyed or assigned to.
+ * @tparam Events : events handled with handle(), numbered in the order of the library.
+ */
+template <class... Events>
+class DynamicMachine {
+public:
+    /**
+     * @brief Build the machine of table; throws std::invalid_argument when table is of another
+     * version or was made for other events. table has to outlive the machine.
+     */
+    explicit DynamicMachine(const machine_abi& table) : DynamicMachine(checked(table), table.prototype) {
+    }
+
+    DynamicMachine(const DynamicMachine& other) : DynamicMachine(*other.abi, other.object) {
+    }
+
+    DynamicMachine(DynamicMachine&& other) noexcept
+        : abi(other.abi),
+          object(std::exchange(other.object, nullptr)),
+          handlers(other.handlers),
+          eventCount(other.eventCount),
+          current(other.current) {
+    }
+
+    DynamicMachine& operator=(const DynamicMachine& other) {
+        if (this != &other) {
+            *this = DynamicMachine(other);
+        }
+        return *this;
+    }
+
+    DynamicMachine& operator=(DynamicMachine&& other) noexcept {
+        if (this != &other) {
+            release();
+            abi = other.abi;
+            object = std::exchange(other.object, nullptr);
+            handlers = other.handlers;
+            eventCount = other.eventCount;
+            current = other.current;
+        }
+        return *this;
+    }
+
+    ~DynamicMachine() {
+        release();
+    }
+
+    template <typename Event>
+    void handle(const Event& event) {
+        constexpr std::size_t eventId = type_index_v<Event, Events...>;
+        static_assert(eventId < sizeof...(Events), "event not handled by this DynamicMachine");
+        current = handlers[current * eventCount + eventId](object, &event, current);
+    }
+
+    /**
+     * @brief Handle the event number tag of the library, e.g. one of the events it appends to
+     * Events, with event pointing to an object of that event type.
+     * @return false, leaving the machine untouched, when the library has no such event.
+     */
+    bool handleTagged(std::size_t tag, const void* event) {
+        if (tag >= eventCount) {
+            return false;
+        }
+        current = handlers[current * eventCount + tag](object, event, current);
+        return true;
+    }
+
+    /**
+     * @brief Transition to state number state without running any hook, e.g. after swapping
+     * library versions.
+     * @return false, leaving the machine untouched, when the library has no such state.
+     */
+    bool enter(std::size_t state) {
+        if (state >= abi->state_count) {
+            return false;
+        }
+        current = abi->enter(object, static_cast<std::uint32_t>(state));
+        return true;
+    }
+
+    std::size_t currentIndex() const noexcept {
+        return current;
+    }
+
+    std::size_t stateCount() const noexcept {
+        return abi->state_count;
+    }
+
+    const machine_abi& table() const noexcept {
+        return *abi;
+    }
+
+private:
+    DynamicMachine(const machine_abi& table, const void* source)
+        : abi(&table), object(allocate(table)), handlers(table.handlers), eventCount(table.event_count) {
+        try {
+            current = table.construct(object, source);
+        } catch (...) {
+            deallocate(table, object);
+            throw;
+        }
+    }
+
+    static const machine_abi& checked(const machine_abi& table) {
+        if (table.version != machine_abi_version) {
+            throw std::invalid_argument("machine_abi of another version");
+        }
+        constexpr std::size_t sizes[] = {sizeof(Events)..., 0};
+        if (table.state_count == 0 || table.event_count < sizeof...(Events)) {
+            throw std::invalid_argument("machine_abi made for other events");
+        }
+        for (std::size_t i = 0; i < sizeof...(Events); ++i) {
+            if (table.event_sizes[i] != sizes[i]) {
+                throw std::invalid_argument("machine_abi made for other events");
+            }
+        }
+        return table;
+    }
+
+    static void* allocate(const machine_abi& table) {
+        return ::operator new(table.machine_size, std::align_val_t{table.machine_align});
+    }
+
+    static void deallocate(const machine_abi& table, void* object) noexcept {
+        ::operator delete(object, std::align_val_t{table.machine_align});
+    }
+
+    void release() noexcept {
+        if (object) {
+            abi->destroy(object);
+            deallocate(*abi, object);
+            object = nullptr;
+        }
+    }
+
+    const machine_abi* abi;
+    void* object;
+    const machine_abi::handler_fn* handlers;
+    std::size_t eventCount;
+    std::uint32_t current = 0;
+};
+
+}  // End of namespace fsm
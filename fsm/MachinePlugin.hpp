@@ -0,0 +1,103 @@
+#pragma once
+
+#include <dlfcn.h>
+
+#include <stdexcept>
+#include <string>
+#include <utility>
+
+#include "DynamicMachine.hpp"
+
+/**
+ * @brief Declare the entry point of a machine library, exported with C linkage.
+ */
+#if defined(__GNUC__)
+#define FSM_PLUGIN_EXPORT extern "C" __attribute__((visibility("default")))
+#else
+#define FSM_PLUGIN_EXPORT extern "C"
+#endif
+
+namespace fsm {
+
+/**
+ * @brief Entry point of a machine library, returning the table of its machine.
+ */
+using machine_entry_fn = const machine_abi* (*)();
+
+/**
+ * @brief Name of the entry point looked up by default.
+ */
+constexpr const char* default_machine_entry = "fsm_machine";
+
+/**
+ * @brief Shared object exporting a machine_abi (see make_machine_abi), loaded with dlopen.
+ * @details The library stays loaded as long as the plugin lives, which has to outlive the
+ * DynamicMachines built from its table. Linking may need -ldl with older C libraries.
+ * @code
+ * fsm::MachinePlugin v1{"./libdoor_v1.so"};
+ * fsm::DynamicMachine<OpenEvent, CloseEvent, LockEvent, UnlockEvent> door{v1.abi()};
+ * door.handle(LockEvent{42});
+ * @endcode
+ */
+class MachinePlugin {
+public:
+    /**
+     * @brief Load the library at path and call its entry point; throws std::runtime_error when
+     * either fails.
+     */
+    explicit MachinePlugin(const std::string& path, const char* entry = default_machine_entry)
+        : library(dlopen(path.c_str(), RTLD_NOW | RTLD_LOCAL)) {
+        if (!library) {
+            throw std::runtime_error(lastError());
+        }
+        void* symbol = dlsym(library, entry);
+        table = symbol ? reinterpret_cast<machine_entry_fn>(symbol)() : nullptr;
+        if (!table) {
+            const std::string error = symbol ? "machine library returned no machine_abi" : lastError();
+            dlclose(library);
+            throw std::runtime_error(error);
+        }
+    }
+
+    MachinePlugin(const MachinePlugin&) = delete;
+    MachinePlugin& operator=(const MachinePlugin&) = delete;
+
+    MachinePlugin(MachinePlugin&& other) noexcept
+        : library(std::exchange(other.library, nullptr)), table(std::exchange(other.table, nullptr)) {
+    }
+
+    MachinePlugin& operator=(MachinePlugin&& other) noexcept {
+        if (this != &other) {
+            close();
+            library = std::exchange(other.library, nullptr);
+            table = std::exchange(other.table, nullptr);
+        }
+        return *this;
+    }
+
+    ~MachinePlugin() {
+        close();
+    }
+
+    const machine_abi& abi() const noexcept {
+        return *table;
+    }
+
+private:
+    static std::string lastError() {
+        const char* error = dlerror();
+        return error ? error : "dlopen failed";
+    }
+
+    void close() noexcept {
+        if (library) {
+            dlclose(library);
+            library = nullptr;
+        }
+    }
+
+    void* library;
+    const machine_abi* table = nullptr;
+};
+
+}  // End of namespace fsm
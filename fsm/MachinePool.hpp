@@ -0,0 +1,478 @@
+#pragma once
+
+#include <algorithm>
+#include <array>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <tuple>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+#include "actions/After.hpp"
+#include "storage/PoolColumn.hpp"
+#include "tools/FlatTuple.hpp"
+#include "tools/IndexRemap.hpp"
+#include "tools/Span.hpp"
+#include "tools/StateIndex.hpp"
+#include "tools/StateTraits.hpp"
+#include "tools/TimingWheel.hpp"
+#include "tools/TransitionMatrix.hpp"
+#include "tools/TypeIndex.hpp"
+
+namespace fsm {
+
+struct snapshot_access;
+
+/**
+ * @brief Structure-of-arrays container for many machines sharing the same states.
+ * @details The current state of every machine is kept in one dense array of state indices,
+ * and the payload of each state type lives in its own column. Events are dispatched through a
+ * compile-time table indexed by the current state, and actions (On, Will, TransitionTo...) see
+ * a lightweight MachinePool::Machine handle bound to one machine id.
+ *
+ * When some state has an After handler the pool also owns a TimingWheel with one preallocated
+ * timer per machine, at timeout_resolution: transitionTo arms the timer of the machine when
+ * entering a state with a timeout and cancels it otherwise, and tick() handles Timeout in the
+ * machines whose timer expired. Pools without timeouts carry none of this.
+ * @tparam States : states of every machine, the first one being the initial state.
+ */
+template <class... States>
+class MachinePool {
+public:
+    using index_type = state_index_t<sizeof...(States)>;
+    using id_type = std::size_t;
+    using timeout_resolution = std::chrono::milliseconds;
+
+    /**
+     * @brief Whether some state has an After handler.
+     */
+    static constexpr bool has_timeouts = (has_timeout_v<States> || ...);
+
+    /**
+     * @brief Machine handle passed to actions, bound to one machine of the pool.
+     */
+    class Machine {
+    public:
+        Machine(MachinePool& pool, id_type id) : pool(pool), machineId(id) {
+        }
+
+        template <typename State>
+        State& transitionTo() noexcept {
+            return pool.template transitionTo<State>(machineId);
+        }
+
+        template <typename Event>
+        void handle(const Event& event) {
+            pool.handle(machineId, event);
+        }
+
+        id_type id() const noexcept {
+            return machineId;
+        }
+
+    private:
+        MachinePool& pool;
+        id_type machineId;
+    };
+
+    MachinePool() = default;
+
+    /**
+     * @brief Construct a pool whose new machines are copies of the given states.
+     */
+    explicit MachinePool(States... prototypes_in) : prototypes(std::move(prototypes_in)...) {
+    }
+
+    /**
+     * @brief Add a machine built from the prototype states.
+     * @return Id of the new machine.
+     */
+    id_type add() {
+        return std::apply([this](const auto&... states) { return add(states...); }, prototypes);
+    }
+
+    /**
+     * @brief Add a machine built from the given states.
+     * @return Id of the new machine.
+     */
+    id_type add(States... states) {
+        (get<PoolColumn<States>>(columns).push_back(std::move(states)), ...);
+        indices.push_back(0);
+        const id_type id = indices.size() - 1;
+        if constexpr (has_timeouts) {
+            timers.resize(indices.size());
+            updateTimer<std::tuple_element_t<0, std::tuple<States...>>>(id);
+        }
+        return id;
+    }
+
+    void reserve(std::size_t count) {
+        indices.reserve(count);
+        (get<PoolColumn<States>>(columns).reserve(count), ...);
+        if constexpr (has_timeouts) {
+            timers.reserve(count);
+        }
+    }
+
+    void clear() {
+        indices.clear();
+        (get<PoolColumn<States>>(columns).clear(), ...);
+        if constexpr (has_timeouts) {
+            timers.clear();
+        }
+    }
+
+    std::size_t size() const noexcept {
+        return indices.size();
+    }
+
+    std::size_t currentIndex(id_type id) const noexcept {
+        return indices[id];
+    }
+
+    template <typename State>
+    State& state(id_type id) noexcept {
+        return get<PoolColumn<State>>(columns).at(id);
+    }
+
+    template <typename State>
+    const State& state(id_type id) const noexcept {
+        return get<PoolColumn<State>>(columns).at(id);
+    }
+
+    template <typename State>
+    State& transitionTo(id_type id) noexcept {
+        indices[id] = static_cast<index_type>(type_index_v<State, States...>);
+        if constexpr (has_timeouts) {
+            if (retimed.empty()) {
+                updateTimer<State>(id);
+            } else {
+                // Inside a parallel broadcast: the timing wheel is updated once it completes.
+                retimed[id] = 1;
+            }
+        }
+        return state<State>(id);
+    }
+
+    /**
+     * @brief Handle Timeout in every machine whose timer expired at or before now.
+     * @details Timeouts are armed relative to the time of the previous tick, so tick() is meant
+     * to be called periodically, with a steady clock, from the thread owning the pool. Timers
+     * armed before the first tick run from that first tick.
+     * @param[in] now : current time, e.g. std::chrono::steady_clock::now().time_since_epoch().
+     * @return Number of timeouts handled.
+     */
+    template <typename Rep, typename Period>
+    std::size_t tick(std::chrono::duration<Rep, Period> now) {
+        return tick(now, [this](id_type id) { handle(id, Timeout{}); });
+    }
+
+    /**
+     * @brief Pass the ids of the machines whose timer expired at or before now to sink(id),
+     * instead of handling Timeout in the pool.
+     */
+    template <typename Rep, typename Period, typename Sink>
+    std::size_t tick(std::chrono::duration<Rep, Period> now, Sink&& sink) {
+        static_assert(has_timeouts, "no state of the pool has an After handler");
+        const auto ticks = std::chrono::duration_cast<timeout_resolution>(now).count();
+        if (!clockStarted) {
+            timers.restart(static_cast<TimingWheel::tick_type>(ticks));
+            clockStarted = true;
+        }
+        return timers.advance(static_cast<TimingWheel::tick_type>(ticks),
+                              [&sink](TimingWheel::key_type key) { sink(static_cast<id_type>(key)); });
+    }
+
+    /**
+     * @brief Whether the timer of a machine is armed.
+     */
+    bool timerArmed(id_type id) const noexcept {
+        if constexpr (has_timeouts) {
+            return timers.armed(static_cast<TimingWheel::key_type>(id));
+        } else {
+            return false;
+        }
+    }
+
+    template <typename Event>
+    static constexpr bool reacts_to() {
+        return (handles_v<States, Event> || ...);
+    }
+
+    template <typename Event>
+    bool wouldReact(id_type id) const noexcept {
+        constexpr bool reacting[] = {handles_v<States, Event>...};
+        return reacting[indices[id]];
+    }
+
+    template <typename Event>
+    void handle(id_type id, const Event& event) {
+        if constexpr (reacts_to<Event>()) {
+            dispatch_table<Event>::lookup_table[indices[id]](*this, id, event);
+        }
+    }
+
+    /**
+     * @brief Pass the event to every machine of the pool, in id order, skipping the machines
+     * whose current state ignores it.
+     */
+    template <typename Event>
+    void handleAll(const Event& event) {
+        if constexpr (reacts_to<Event>()) {
+            handleRange(0, indices.size(), event);
+        }
+    }
+
+    /**
+     * @brief Pass the event to every machine, in parallel chunks run with an execution policy
+     * (std::execution::par_unseq...), and return once all are handled.
+     * @details The dense index array is split into chunks of whole cache lines, so that no two
+     * chunks write to the same line of it; machines whose current state ignores the event are
+     * skipped without calling into the dispatch table. Handlers of one machine must only touch
+     * that machine, and must not synchronize under an unsequenced policy. The timers of the
+     * machines changing state are re-armed after the parallel pass, as if handled serially.
+     * The overloads taking a policy are declared by <algorithm> and defined by <execution>,
+     * which naming a policy needs.
+     */
+    template <typename ExecutionPolicy, typename Event>
+    void handleAll(ExecutionPolicy&& policy, const Event& event) {
+        if constexpr (reacts_to<Event>()) {
+            if constexpr (has_timeouts) {
+                retimed.assign(indices.size(), 0);
+            }
+            forEachChunk(std::forward<ExecutionPolicy>(policy),
+                         [this, &event](id_type first, id_type last) { handleRange(first, last, event); });
+            if constexpr (has_timeouts) {
+                rearmRetimed();
+            }
+        }
+    }
+
+    /**
+     * @brief Call fn(id, state) for every machine in State, in id order.
+     */
+    template <typename State, typename Fn>
+    void forEachInState(Fn&& fn) {
+        visitInState<State>(0, indices.size(), fn);
+    }
+
+    /**
+     * @brief Call fn(id, state) for every machine in State, in parallel chunks as in
+     * handleAll(policy, event); fn must not transition the machines.
+     */
+    template <typename State, typename ExecutionPolicy, typename Fn>
+    void forEachInState(ExecutionPolicy&& policy, Fn&& fn) {
+        forEachChunk(std::forward<ExecutionPolicy>(policy),
+                     [this, &fn](id_type first, id_type last) { visitInState<State>(first, last, fn); });
+    }
+
+    /**
+     * @brief Pass the event to every machine through the compile-time transition matrix.
+     * @details Machines in table-driven states (see is_table_driven) only get their state
+     * index rewritten, in bulk and with SIMD shuffles when available, so their handlers are
+     * not called. Machines in any other state, including the states with a timeout, go through
+     * the regular handler path.
+     */
+    template <typename Event>
+    void applyUniform(const Event& event) {
+        using matrix = uniform_transition_matrix<Event, States...>;
+        auto onGeneric = [this, &event](id_type id) { handle(id, event); };
+        remap_indices<!matrix::all_table_driven>(indices.data(), indices.size(), matrix::next, matrix::generic,
+                                                 onGeneric);
+    }
+
+    /**
+     * @brief Same as applyUniform(event), restricted to the given machines.
+     */
+    template <typename Event>
+    void applyUniform(const Event& event, span<const id_type> ids) {
+        using matrix = uniform_transition_matrix<Event, States...>;
+        for (const id_type id : ids) {
+            const auto current = indices[id];
+            if (matrix::generic[current]) {
+                handle(id, event);
+            } else {
+                indices[id] = matrix::next[current];
+            }
+        }
+    }
+
+private:
+    friend struct snapshot_access;
+
+    struct no_timers {
+    };
+
+    /**
+     * @brief Machines [first, last) of a broadcast.
+     */
+    struct chunk_type {
+        id_type first;
+        id_type last;
+    };
+
+    static constexpr std::size_t cache_line = 64;
+
+    /**
+     * @brief Number of machines of a broadcast chunk, whose indices span 16 cache lines.
+     */
+    static constexpr std::size_t chunk_size = 16 * cache_line / sizeof(index_type);
+
+    /**
+     * @brief Run visit(first, last) over chunks of machines, the inner ones starting on a cache
+     * line of the index array.
+     */
+    template <typename ExecutionPolicy, typename Visit>
+    void forEachChunk(ExecutionPolicy&& policy, Visit&& visit) {
+        const std::size_t count = indices.size();
+        const auto address = reinterpret_cast<std::uintptr_t>(indices.data());
+        const std::size_t head = (cache_line - address % cache_line) % cache_line / sizeof(index_type);
+        std::vector<chunk_type> chunks;
+        chunks.reserve(count / chunk_size + 2);
+        for (id_type first = 0; first < count;) {
+            const id_type last = std::min(count, first == 0 && head > 0 ? head : first + chunk_size);
+            chunks.push_back({first, last});
+            first = last;
+        }
+        std::for_each(std::forward<ExecutionPolicy>(policy), chunks.begin(), chunks.end(),
+                      [&visit](const chunk_type& chunk) { visit(chunk.first, chunk.last); });
+    }
+
+    template <typename Event>
+    void handleRange(id_type first, id_type last, const Event& event) {
+        constexpr bool reacting[] = {handles_v<States, Event>...};
+        constexpr bool everyStateReacts = (handles_v<States, Event> && ...);
+        auto& table = dispatch_table<Event>::lookup_table;
+        for (id_type id = first; id < last; ++id) {
+            const auto current = indices[id];
+            if (everyStateReacts || reacting[current]) {
+                table[current](*this, id, event);
+            }
+        }
+    }
+
+    template <typename State, typename Fn>
+    void visitInState(id_type first, id_type last, Fn& fn) {
+        constexpr auto stateIndex = static_cast<index_type>(type_index_v<State, States...>);
+        auto& column = get<PoolColumn<State>>(columns);
+        for (id_type id = first; id < last; ++id) {
+            if (indices[id] == stateIndex) {
+                fn(id, column.at(id));
+            }
+        }
+    }
+
+    /**
+     * @brief Update the timers of the machines that changed state during a parallel broadcast.
+     */
+    void rearmRetimed() {
+        const std::size_t count = retimed.size();
+        for (id_type id = 0; id < count; ++id) {
+            if (retimed[id]) {
+                resetTimers(id, 1);
+            }
+        }
+        retimed.clear();
+    }
+
+    template <typename State>
+    static constexpr TimingWheel::tick_type timeoutTicks() {
+        if constexpr (has_timeout_v<State>) {
+            using duration = typename State::timeout_duration;
+            return static_cast<TimingWheel::tick_type>(std::chrono::ceil<timeout_resolution>(duration{1}).count());
+        } else {
+            return 0;
+        }
+    }
+
+    template <typename State>
+    void updateTimer(id_type id) noexcept {
+        const auto key = static_cast<TimingWheel::key_type>(id);
+        if constexpr (has_timeout_v<State>) {
+            timers.armAfter(key, timeoutTicks<State>());
+        } else {
+            timers.cancel(key);
+        }
+    }
+
+    /**
+     * @brief Re-arm the timers of machines [first, first + count) only, after a range of
+     * indices was rewritten.
+     */
+    void resetTimers(id_type first, std::size_t count) {
+        if constexpr (has_timeouts) {
+            constexpr bool timed[] = {has_timeout_v<States>...};
+            constexpr TimingWheel::tick_type delays[] = {timeoutTicks<States>()...};
+            timers.resize(indices.size());
+            for (id_type id = first; id < first + count; ++id) {
+                const auto key = static_cast<TimingWheel::key_type>(id);
+                if (timed[indices[id]]) {
+                    timers.armAfter(key, delays[indices[id]]);
+                } else {
+                    timers.cancel(key);
+                }
+            }
+        } else {
+            (void)first;
+            (void)count;
+        }
+    }
+
+    /**
+     * @brief Disarm the timers of machines [first, first + count), e.g. while they move to
+     * another pool.
+     */
+    void cancelTimers(id_type first, std::size_t count) noexcept {
+        if constexpr (has_timeouts) {
+            for (id_type id = first; id < first + count; ++id) {
+                timers.cancel(static_cast<TimingWheel::key_type>(id));
+            }
+        } else {
+            (void)first;
+            (void)count;
+        }
+    }
+
+    template <typename Event, typename = std::index_sequence_for<States...>>
+    struct dispatch_table;
+
+    template <typename Event, std::size_t... Idxs>
+    struct dispatch_table<Event, std::index_sequence<Idxs...>> {
+        template <std::size_t Ind>
+        static void dispatchToState(MachinePool& pool, id_type id, const Event& event) {
+            auto& state = get<Ind>(pool.columns).at(id);
+            Machine machine{pool, id};
+            auto action = state.handle(event);
+            action.execute(machine, state, event);
+        }
+
+        static void ignore(MachinePool&, id_type, const Event&) noexcept {
+        }
+
+        using dispatch_fun_ptr = void (*)(MachinePool&, id_type, const Event&);
+
+        template <std::size_t Ind>
+        static constexpr dispatch_fun_ptr entry() {
+            if constexpr (handles_v<std::tuple_element_t<Ind, std::tuple<States...>>, Event>) {
+                return &dispatchToState<Ind>;
+            } else {
+                return &ignore;
+            }
+        }
+
+        constexpr static std::array<dispatch_fun_ptr, sizeof...(Idxs)> lookup_table = {{entry<Idxs>()...}};
+    };
+
+    std::vector<index_type> indices;
+    flat_tuple<PoolColumn<States>...> columns;
+    std::tuple<States...> prototypes;
+    std::conditional_t<has_timeouts, TimingWheel, no_timers> timers;
+    /// Whether tick() set the time of the timers yet.
+    std::conditional_t<has_timeouts, bool, no_timers> clockStarted{};
+    /// Machines that changed state during a parallel broadcast, empty outside of one.
+    std::conditional_t<has_timeouts, std::vector<unsigned char>, no_timers> retimed;
+};
+
+}  // End of namespace fsm
@@ -0,0 +1,298 @@
+#pragma once
+
+#include <array>
+#include <cstddef>
+#include <tuple>
+#include <type_traits>
+#include <utility>
+
+#include "StateMachine.hpp"
+#include "actions/Nothing.hpp"
+#include "policies/EventQueue.hpp"
+#include "tools/StateTraits.hpp"
+#include "tools/TypeIndex.hpp"
+
+namespace fsm {
+
+template <typename Parent, typename ChildMachine>
+class Nested;
+
+template <typename Parent, typename ChildMachine>
+std::true_type is_nested_test(const Nested<Parent, ChildMachine>*);
+
+std::false_type is_nested_test(const void*);
+
+/**
+ * @brief Whether State is a Nested state or derives from one.
+ */
+template <typename State>
+constexpr bool is_nested_v = decltype(is_nested_test(std::declval<State*>()))::value;
+
+/**
+ * @brief Machine seen by the actions of the children of a Nested state.
+ * @details Transitions to a sibling stay in the child machine. Transitions to any other state
+ * leave the parent (the child has already been left by TransitionTo) and are forwarded to the
+ * enclosing machine, which may itself be a nested_machine.
+ */
+template <typename NestedState, typename Machine, typename Event>
+class nested_machine {
+public:
+    nested_machine(NestedState& nested, Machine& machine, const Event& event)
+        : nested(nested), machine(machine), event(event) {
+    }
+
+    template <typename State>
+    State& transitionTo() {
+        if constexpr (NestedState::template is_child_v<State>) {
+            return nested.children().template transitionTo<State>();
+        } else {
+            if constexpr (can_post_v<Machine>) {
+                event_poster<Machine> poster{machine};
+                nested.leaveParent(event, poster);
+            } else {
+                nested.leaveParent(event);
+            }
+            return machine.template transitionTo<State>();
+        }
+    }
+
+    /**
+     * @brief Post to, and count the events queued in, the enclosing machine when it has a
+     * run-to-completion queue.
+     */
+    template <typename Posted, typename Target = Machine>
+    auto post(Posted&& posted) -> decltype(std::declval<Target&>().post(std::forward<Posted>(posted))) {
+        return machine.post(std::forward<Posted>(posted));
+    }
+
+    template <typename Target = Machine>
+    auto pending() const noexcept -> decltype(std::declval<const Target&>().pending()) {
+        return machine.pending();
+    }
+
+    /**
+     * @brief Hand the coroutine of a child onEnter hook to the enclosing machine.
+     */
+    template <typename Task, typename Target = Machine>
+    auto suspendOn(Task&& task) noexcept -> decltype(std::declval<Target&>().suspendOn(std::forward<Task>(task))) {
+        return machine.suspendOn(std::forward<Task>(task));
+    }
+
+private:
+    NestedState& nested;
+    Machine& machine;
+    const Event& event;
+};
+
+/**
+ * @brief Superstate made of a Parent state and a machine of child states.
+ * @details Events go to the current child first. A child whose handler resolves to Nothing at
+ * compile time does not see the event at all, the handler of Parent runs instead, and a Parent
+ * resolving to Nothing in turn lets the event bubble to the enclosing Nested, if any. Which
+ * handler runs is fixed per (child, event) pair in a lookup table indexed by the current child,
+ * so bubbling costs no runtime walk. (A Maybe, OneOf or If holding Nothing at runtime does not
+ * bubble.)
+ *
+ * Entering the superstate runs Parent::onEnter, resets the children to the first one and runs
+ * its onEnter; leaving it runs the onLeave of the current child, then Parent::onLeave. A child
+ * transition to a state outside of the superstate leaves the child, then the parent, then enters
+ * the target.
+ * @code
+ * struct Connected : Will<ByDefault<Nothing>, On<Disconnect, TransitionTo<Idle>>> {};
+ * using Session = Nested<Connected, StateMachine<Handshake, Ready, Busy>>;
+ * using Link = StateMachine<Idle, Session>;
+ * @endcode
+ * @tparam Parent : state handling the events its children do not.
+ * @tparam ChildMachine : BasicStateMachine of the child states.
+ */
+template <typename Parent, class Policy, class... Children>
+class Nested<Parent, BasicStateMachine<Policy, Children...>> : public Parent {
+public:
+    using parent_type = Parent;
+    using child_machine = BasicStateMachine<Policy, Children...>;
+
+    template <typename State>
+    static constexpr bool is_child_v = type_index_v<State, Children...> < sizeof...(Children);
+
+    /**
+     * @brief Action returned by handle(); dispatches to the current child when executed.
+     */
+    struct Dispatch {
+        template <typename Machine, typename Self, typename Event>
+        void execute(Machine& machine, Self& self, const Event& event) {
+            auto unhandled = [&machine, &self, &event] { Nothing{}.execute(machine, self, event); };
+            Nested::dispatch(self, machine, event, unhandled);
+        }
+    };
+
+    Nested() = default;
+
+    explicit Nested(Parent parent, child_machine children = {})
+        : Parent(std::move(parent)), childMachine(std::move(children)) {
+    }
+
+    /**
+     * @brief Whether some child or the parent reacts to Event, recursively.
+     */
+    template <typename Event>
+    static constexpr bool reacts_to() {
+        return (handles_v<Children, Event> || ...) || handles_v<Parent, Event>;
+    }
+
+    template <typename Event>
+    std::conditional_t<reacts_to<Event>(), Dispatch, Nothing> handle(const Event&) const noexcept {
+        return {};
+    }
+
+    template <typename Event>
+    void onEnter(const Event& event) {
+        enterWith(event, static_cast<no_poster*>(nullptr));
+    }
+
+    /**
+     * @brief Entry with a poster, preferred by TransitionTo; hooks of the parent and children
+     * taking a poster receive it.
+     */
+    template <typename Event, typename Poster>
+    void onEnter(const Event& event, Poster& poster) {
+        enterWith(event, &poster);
+    }
+
+    template <typename Event>
+    void onLeave(const Event& event) {
+        leaveWith(event, static_cast<no_poster*>(nullptr));
+    }
+
+    template <typename Event, typename Poster>
+    void onLeave(const Event& event, Poster& poster) {
+        leaveWith(event, &poster);
+    }
+
+    child_machine& children() noexcept {
+        return childMachine;
+    }
+
+    const child_machine& children() const noexcept {
+        return childMachine;
+    }
+
+    /**
+     * @brief Handle event in the current child of self, or in the parent when the child does not
+     * react, calling unhandled when neither does.
+     * @param[in] self : this superstate, as the (possibly derived) state type of the machine.
+     */
+    template <typename Self, typename Machine, typename Event, typename Unhandled>
+    static void dispatch(Self& self, Machine& machine, const Event& event, Unhandled& unhandled) {
+        using table = dispatch_table<Self, Machine, Event, Unhandled>;
+        table::lookup_table[self.childMachine.currentIndex()](self, machine, event, unhandled);
+    }
+
+    template <typename Event>
+    void leaveParent(const Event& event) {
+        leaveState(static_cast<Parent&>(*this), event, static_cast<no_poster*>(nullptr));
+    }
+
+    template <typename Event, typename Poster>
+    void leaveParent(const Event& event, Poster& poster) {
+        leaveState(static_cast<Parent&>(*this), event, &poster);
+    }
+
+private:
+    struct no_poster {
+    };
+
+    template <typename Event, typename Poster>
+    void enterWith(const Event& event, Poster* poster) {
+        enterState(static_cast<Parent&>(*this), event, poster);
+        using Initial = std::tuple_element_t<0, std::tuple<Children...>>;
+        enterState(childMachine.template transitionTo<Initial>(), event, poster);
+    }
+
+    template <typename Event, typename Poster>
+    void leaveWith(const Event& event, Poster* poster) {
+        leave_table<Event, Poster>::lookup_table[childMachine.currentIndex()](*this, event, poster);
+        leaveState(static_cast<Parent&>(*this), event, poster);
+    }
+
+    template <typename State, typename Event, typename Poster>
+    static void leaveState(State& state, const Event& event, Poster* poster) {
+        if constexpr (!std::is_same_v<Poster, no_poster> && has_posting_on_leave_v<State, Event, Poster>) {
+            state.onLeave(event, *poster);
+        } else if constexpr (has_on_leave_v<State, Event>) {
+            state.onLeave(event);
+        }
+    }
+
+    template <typename State, typename Event, typename Poster>
+    static void enterState(State& state, const Event& event, Poster* poster) {
+        if constexpr (!std::is_same_v<Poster, no_poster> && has_posting_on_enter_v<State, Event, Poster>) {
+            // Entering the superstate runs these hooks from its own onEnter, which cannot wait.
+            static_assert(!suspends_machine_v<decltype(state.onEnter(event, *poster))>,
+                          "the onEnter of the parent and of the first child of a Nested state cannot suspend");
+            state.onEnter(event, *poster);
+        } else if constexpr (has_on_enter_v<State, Event>) {
+            static_assert(!suspends_machine_v<decltype(state.onEnter(event))>,
+                          "the onEnter of the parent and of the first child of a Nested state cannot suspend");
+            state.onEnter(event);
+        }
+    }
+
+    template <typename Self, typename Machine, typename Event, typename Unhandled>
+    static void handleInParent(Self& self, Machine& machine, const Event& event, Unhandled& unhandled) {
+        if constexpr (!handles_v<Parent, Event>) {
+            unhandled();
+        } else {
+            auto action = static_cast<const Parent&>(self).handle(event);
+            action.execute(machine, self, event);
+        }
+    }
+
+    template <typename Self, typename Machine, typename Event, typename Unhandled,
+              typename = std::index_sequence_for<Children...>>
+    struct dispatch_table;
+
+    template <typename Self, typename Machine, typename Event, typename Unhandled, std::size_t... Idxs>
+    struct dispatch_table<Self, Machine, Event, Unhandled, std::index_sequence<Idxs...>> {
+        template <std::size_t Ind>
+        static void dispatchToChild(Self& self, Machine& machine, const Event& event, Unhandled& unhandled) {
+            using Child = std::tuple_element_t<Ind, std::tuple<Children...>>;
+            auto& child = self.childMachine.template state<Child>();
+            nested_machine<Self, Machine, Event> proxy{self, machine, event};
+            if constexpr (is_nested_v<Child>) {
+                auto bubble = [&self, &machine, &event, &unhandled] {
+                    handleInParent(self, machine, event, unhandled);
+                };
+                Child::dispatch(child, proxy, event, bubble);
+            } else if constexpr (!handles_v<Child, Event>) {
+                handleInParent(self, machine, event, unhandled);
+            } else {
+                auto action = child.handle(event);
+                action.execute(proxy, child, event);
+            }
+        }
+
+        using dispatch_fun_ptr = void (*)(Self&, Machine&, const Event&, Unhandled&);
+
+        constexpr static std::array<dispatch_fun_ptr, sizeof...(Idxs)> lookup_table = {{&dispatchToChild<Idxs>...}};
+    };
+
+    template <typename Event, typename Poster, typename = std::index_sequence_for<Children...>>
+    struct leave_table;
+
+    template <typename Event, typename Poster, std::size_t... Idxs>
+    struct leave_table<Event, Poster, std::index_sequence<Idxs...>> {
+        template <std::size_t Ind>
+        static void leaveChild(Nested& self, const Event& event, Poster* poster) {
+            using Child = std::tuple_element_t<Ind, std::tuple<Children...>>;
+            leaveState(self.childMachine.template state<Child>(), event, poster);
+        }
+
+        using leave_fun_ptr = void (*)(Nested&, const Event&, Poster*);
+
+        constexpr static std::array<leave_fun_ptr, sizeof...(Idxs)> lookup_table = {{&leaveChild<Idxs>...}};
+    };
+
+    child_machine childMachine;
+};
+
+}  // End of namespace fsm
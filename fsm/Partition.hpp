@@ -0,0 +1,479 @@
+#pragma once
+
+#include <algorithm>
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <type_traits>
+#include <unordered_map>
+#include <vector>
+
+#include "MachinePool.hpp"
+#include "Snapshot.hpp"
+#include "tools/EventLog.hpp"
+#include "tools/Span.hpp"
+#include "tools/TypeIndex.hpp"
+
+namespace fsm {
+
+/**
+ * @brief Consistent-hash assignment of the machines of a cluster to its nodes.
+ * @details Machine ids are grouped in partitions of partitionSize consecutive ids, so that a
+ * partition is a contiguous slice of every column of a MachinePool. Each node is placed at
+ * replicas points of a hash ring and a partition belongs to the first node at or after its own
+ * hash: adding or removing a node only moves the partitions next to the points of that node.
+ * Every node of the cluster has to build the same map.
+ */
+class PartitionMap {
+public:
+    using id_type = std::size_t;
+    using node_type = std::uint32_t;
+
+    explicit PartitionMap(std::size_t partitionSize, std::size_t replicas = 64)
+        : length(partitionSize > 0 ? partitionSize : 1), replicas(replicas > 0 ? replicas : 1) {
+    }
+
+    void addNode(node_type node) {
+        removeNode(node);
+        for (std::size_t replica = 0; replica < replicas; ++replica) {
+            ring.push_back({hash(((std::uint64_t{node} << 32) | replica) ^ node_salt), node});
+        }
+        std::sort(ring.begin(), ring.end());
+    }
+
+    void removeNode(node_type node) {
+        ring.erase(std::remove_if(ring.begin(), ring.end(), [node](const point& p) { return p.node == node; }),
+                   ring.end());
+    }
+
+    bool empty() const noexcept {
+        return ring.empty();
+    }
+
+    /**
+     * @brief Number of machine ids in each partition.
+     */
+    std::size_t partitionSize() const noexcept {
+        return length;
+    }
+
+    std::size_t partitionOf(id_type id) const noexcept {
+        return id / length;
+    }
+
+    /**
+     * @brief First machine id of a partition.
+     */
+    id_type first(std::size_t partition) const noexcept {
+        return partition * length;
+    }
+
+    /**
+     * @brief Node owning a partition; the map must have a node.
+     */
+    node_type owner(std::size_t partition) const noexcept {
+        const point key{hash(partition), 0};
+        const auto found = std::lower_bound(ring.begin(), ring.end(), key);
+        return (found == ring.end() ? ring.front() : *found).node;
+    }
+
+    node_type ownerOf(id_type id) const noexcept {
+        return owner(partitionOf(id));
+    }
+
+private:
+    struct point {
+        std::uint64_t hash;
+        node_type node;
+
+        bool operator<(const point& other) const noexcept {
+            return hash < other.hash || (hash == other.hash && node < other.node);
+        }
+    };
+
+    static constexpr std::uint64_t node_salt = 0x9e3779b97f4a7c15ULL;
+
+    static std::uint64_t hash(std::uint64_t key) noexcept {
+        key ^= key >> 33;
+        key *= 0xff51afd7ed558ccdULL;
+        key ^= key >> 33;
+        key *= 0xc4ceb9fe1a85ec53ULL;
+        key ^= key >> 33;
+        return key;
+    }
+
+    std::size_t length;
+    std::size_t replicas;
+    std::vector<point> ring;
+};
+
+/**
+ * @brief Header opening a partition block: the snapshot of its machines follows, on a
+ * snapshot section boundary, then the records of the events pending for them.
+ */
+struct partition_header {
+    std::uint32_t magic;
+    std::uint16_t version;
+    std::uint16_t reserved;
+    std::uint64_t first;
+    std::uint64_t snapshotSize;
+    std::uint64_t eventCount;
+    std::uint64_t eventSize;
+};
+
+/**
+ * @brief Record of one pending event: its payload, size bytes padded to event_log_alignment,
+ * follows.
+ */
+struct partition_event {
+    std::uint64_t id;
+    std::uint32_t type;
+    std::uint32_t size;
+};
+
+constexpr std::uint32_t partition_magic = 0x50565346;  // "FSVP"
+constexpr std::uint16_t partition_version = 1;
+
+/**
+ * @brief The partitions of a PartitionMap held by one node, in a MachinePool indexed by the
+ * machine ids of the whole cluster.
+ * @details Events go through handle(), which is false for machines held elsewhere, to be sent
+ * to map.ownerOf(id). Moving a partition to another node costs one memcpy per column:
+ *  - the source calls beginHandoff(partition): from then on the events of its machines are
+ *    buffered, in order, instead of handled;
+ *  - the destination calls expect(partition) to buffer the events routed to it early;
+ *  - once senders route the partition to the destination, the source extract()s it into one
+ *    block holding the states of its machines and the buffered events, and stops holding it;
+ *  - the destination adopt()s the block: it copies the states in, handles the events of the
+ *    block, then the ones it buffered itself, and holds the partition.
+ * Events of one machine are thus handled in the order they were sent, as long as they are sent
+ * from one thread. The timers of a partition are disarmed when its handoff begins, or when it
+ * is extracted without one, so that pool.tick() neither handles Timeout in buffering machines
+ * nor keeps the timers of machines held elsewhere; adopt() re-arms them with a full timeout
+ * from the last tick, as deserialize does. Machines added to the pool only to fill the gaps
+ * before the partitions of this node have no timer either.
+ * @tparam Pool : MachinePool of trivially copyable states.
+ * @tparam Events : events which can be pending during a handoff, trivially copyable and
+ * default constructible.
+ */
+template <class Pool, class... Events>
+class PartitionNode {
+    static_assert(((std::is_trivially_copyable_v<Events> && std::is_default_constructible_v<Events>) && ...),
+                  "pending events are copied as bytes into partition blocks");
+
+public:
+    using id_type = typename Pool::id_type;
+    using node_type = PartitionMap::node_type;
+
+    /**
+     * @param[in] map : partitions of the cluster, must outlive the node.
+     * @param[in] pool : machines of this node, must outlive it.
+     */
+    PartitionNode(const PartitionMap& map, node_type self, Pool& pool) : map(map), self(self), pool(pool) {
+    }
+
+    /**
+     * @brief Hold the partitions the map assigns to this node, adding the missing machines of
+     * these partitions to the pool, e.g. when a cluster starts.
+     * @param[in] machineCount : number of machine ids in the cluster.
+     */
+    void claim(std::size_t machineCount) {
+        const std::size_t partitionCount = (machineCount + map.partitionSize() - 1) / map.partitionSize();
+        const std::size_t added = pool.size();
+        for (std::size_t partition = 0; partition < partitionCount; ++partition) {
+            if (map.owner(partition) == self) {
+                statusAt(partition) = status::held;
+                const std::size_t end = std::min(map.first(partition) + map.partitionSize(), machineCount);
+                while (pool.size() < end) {
+                    pool.add();
+                }
+            }
+        }
+        disarmUnheld(added, pool.size());
+    }
+
+    bool holds(std::size_t partition) const noexcept {
+        return statusOf(partition) == status::held;
+    }
+
+    /**
+     * @brief Whether the events of a partition are buffered, during a handoff.
+     */
+    bool buffering(std::size_t partition) const noexcept {
+        return statusOf(partition) == status::buffering;
+    }
+
+    /**
+     * @brief Handle event in machine id, or buffer it while the partition of id is moving.
+     * @return false when the partition is held by another node.
+     */
+    template <typename Event>
+    bool handle(id_type id, const Event& event) {
+        static_assert(type_index_v<Event, Events...> < sizeof...(Events), "event not listed in PartitionNode");
+        const std::size_t partition = map.partitionOf(id);
+        switch (statusOf(partition)) {
+        case status::held:
+            pool.handle(id, event);
+            return true;
+        case status::buffering:
+            append(pending[partition], id, event);
+            return true;
+        default:
+            return false;
+        }
+    }
+
+    /**
+     * @brief Buffer the events of a held partition until it is extracted.
+     */
+    void beginHandoff(std::size_t partition) {
+        if (holds(partition)) {
+            statusAt(partition) = status::buffering;
+            disarm(partition);
+        }
+    }
+
+    /**
+     * @brief Buffer the events of a partition this node is about to adopt.
+     */
+    void expect(std::size_t partition) {
+        if (statusOf(partition) == status::absent) {
+            statusAt(partition) = status::buffering;
+            incoming.push_back(partition);
+        }
+    }
+
+    /**
+     * @brief Size of the block extract(partition) writes.
+     */
+    std::size_t blockSize(std::size_t partition) const noexcept {
+        const auto found = pending.find(partition);
+        const std::size_t events = found != pending.end() ? found->second.size() : 0;
+        return snapshotOffset() + layout::size(machinesIn(partition)) + events;
+    }
+
+    /**
+     * @brief Write the machines of a held or buffering partition and its buffered events into
+     * out, then stop holding it.
+     * @return Number of bytes written, 0 when this node does not hold the partition or out is
+     * smaller than blockSize(partition).
+     */
+    std::size_t extract(std::size_t partition, span<std::byte> out) {
+        const status current = statusOf(partition);
+        if ((current != status::held && current != status::buffering) || isIncoming(partition) ||
+            out.size() < blockSize(partition)) {
+            return 0;
+        }
+        const std::size_t count = machinesIn(partition);
+        const std::size_t snapshotSize =
+            serialize(pool, map.first(partition), count, out.subspan(snapshotOffset(), layout::size(count)));
+        const auto found = pending.find(partition);
+        const std::vector<std::byte> none;
+        const std::vector<std::byte>& events = found != pending.end() ? found->second : none;
+        const partition_header header{partition_magic,
+                                      partition_version,
+                                      0,
+                                      static_cast<std::uint64_t>(map.first(partition)),
+                                      static_cast<std::uint64_t>(snapshotSize),
+                                      static_cast<std::uint64_t>(countOf(events)),
+                                      static_cast<std::uint64_t>(events.size())};
+        std::memset(out.data(), 0, snapshotOffset());
+        std::memcpy(out.data(), &header, sizeof(header));
+        if (!events.empty()) {
+            std::memcpy(out.data() + snapshotOffset() + snapshotSize, events.data(), events.size());
+        }
+        const std::size_t written = snapshotOffset() + snapshotSize + events.size();
+        if (found != pending.end()) {
+            pending.erase(found);
+        }
+        disarm(partition);
+        statusAt(partition) = status::absent;
+        return written;
+    }
+
+    /**
+     * @brief Take over the partition held in a block written by extract, then handle its
+     * pending events and the ones buffered here since expect().
+     * @return false, leaving the node untouched, for a truncated or foreign block, or a
+     * partition this node holds already.
+     */
+    bool adopt(span<const std::byte> block) {
+        partition_header header;
+        if (block.size() < snapshotOffset()) {
+            return false;
+        }
+        std::memcpy(&header, block.data(), sizeof(header));
+        if (header.magic != partition_magic || header.version != partition_version ||
+            header.first % map.partitionSize() != 0 || header.snapshotSize > block.size() - snapshotOffset() ||
+            header.eventSize > block.size() - snapshotOffset() - header.snapshotSize) {
+            return false;
+        }
+        const auto first = static_cast<std::size_t>(header.first);
+        const std::size_t partition = map.partitionOf(first);
+        const auto snapshot = block.subspan(snapshotOffset(), static_cast<std::size_t>(header.snapshotSize));
+        const auto events =
+            block.subspan(snapshotOffset() + snapshot.size(), static_cast<std::size_t>(header.eventSize));
+        std::size_t count = 0;
+        if (holds(partition) || !layout::validate(snapshot, count) || count > map.partitionSize() ||
+            !wellFormed(events, first, count)) {
+            return false;
+        }
+        const std::size_t added = pool.size();
+        deserialize(pool, first, snapshot);
+        disarmUnheld(added, first);
+        replay(events);
+        const auto found = pending.find(partition);
+        if (found != pending.end()) {
+            replay(found->second);
+            pending.erase(found);
+        }
+        incoming.erase(std::remove(incoming.begin(), incoming.end(), partition), incoming.end());
+        statusAt(partition) = status::held;
+        return true;
+    }
+
+    Pool& machines() noexcept {
+        return pool;
+    }
+
+    const Pool& machines() const noexcept {
+        return pool;
+    }
+
+private:
+    template <class P>
+    struct layout_of;
+
+    template <class... States>
+    struct layout_of<MachinePool<States...>> {
+        using type = snapshot_layout<States...>;
+    };
+
+    using layout = typename layout_of<Pool>::type;
+
+    enum class status : std::uint8_t { absent, held, buffering };
+
+    static constexpr std::size_t snapshotOffset() noexcept {
+        return layout::align(sizeof(partition_header));
+    }
+
+    status statusOf(std::size_t partition) const noexcept {
+        return partition < statuses.size() ? statuses[partition] : status::absent;
+    }
+
+    status& statusAt(std::size_t partition) {
+        if (partition >= statuses.size()) {
+            statuses.resize(partition + 1, status::absent);
+        }
+        return statuses[partition];
+    }
+
+    bool isIncoming(std::size_t partition) const noexcept {
+        return std::find(incoming.begin(), incoming.end(), partition) != incoming.end();
+    }
+
+    /**
+     * @brief Machines of a partition present in the pool, the last partition being short.
+     */
+    std::size_t machinesIn(std::size_t partition) const noexcept {
+        const std::size_t first = map.first(partition);
+        return first < pool.size() ? std::min(map.partitionSize(), pool.size() - first) : 0;
+    }
+
+    void disarm(std::size_t partition) noexcept {
+        snapshot_access::cancelTimers(pool, map.first(partition), machinesIn(partition));
+    }
+
+    /**
+     * @brief Disarm the timers of the machines in [first, end) whose partition is not held here.
+     */
+    void disarmUnheld(std::size_t first, std::size_t end) noexcept {
+        for (std::size_t id = first; id < end; ++id) {
+            if (!holds(map.partitionOf(id))) {
+                snapshot_access::cancelTimers(pool, id, 1);
+            }
+        }
+    }
+
+    template <typename Event>
+    static void append(std::vector<std::byte>& buffer, id_type id, const Event& event) {
+        const partition_event record{static_cast<std::uint64_t>(id),
+                                     static_cast<std::uint32_t>(type_index_v<Event, Events...>),
+                                     static_cast<std::uint32_t>(sizeof(Event))};
+        const std::size_t offset = buffer.size();
+        buffer.resize(offset + sizeof(record) + event_log_padded(sizeof(Event)));
+        std::memcpy(buffer.data() + offset, &record, sizeof(record));
+        std::memcpy(buffer.data() + offset + sizeof(record), &event, sizeof(Event));
+    }
+
+    /**
+     * @brief Call sink(record, payload) for every event record of bytes, in order, while it
+     * returns true.
+     */
+    template <typename Sink>
+    static bool forEachEvent(span<const std::byte> bytes, Sink&& sink) {
+        std::size_t offset = 0;
+        while (offset < bytes.size()) {
+            partition_event record;
+            if (bytes.size() - offset < sizeof(record)) {
+                return false;
+            }
+            std::memcpy(&record, bytes.data() + offset, sizeof(record));
+            const std::size_t length = sizeof(record) + event_log_padded(record.size);
+            if (length > bytes.size() - offset || !sink(record, bytes.data() + offset + sizeof(record))) {
+                return false;
+            }
+            offset += length;
+        }
+        return true;
+    }
+
+    static std::size_t countOf(const std::vector<std::byte>& events) {
+        std::size_t count = 0;
+        forEachEvent(span<const std::byte>(events.data(), events.size()),
+                     [&count](const partition_event&, const std::byte*) {
+                         ++count;
+                         return true;
+                     });
+        return count;
+    }
+
+    static bool wellFormed(span<const std::byte> events, std::size_t first, std::size_t count) {
+        return forEachEvent(events, [first, count](const partition_event& record, const std::byte*) {
+            return record.type < sizeof...(Events) && record.size == sizes[record.type] && record.id >= first &&
+                   record.id - first < count;
+        });
+    }
+
+    void replay(span<const std::byte> events) {
+        forEachEvent(events, [this](const partition_event& record, const std::byte* payload) {
+            handlers[record.type](pool, static_cast<id_type>(record.id), payload);
+            return true;
+        });
+    }
+
+    void replay(const std::vector<std::byte>& events) {
+        replay(span<const std::byte>(events.data(), events.size()));
+    }
+
+    template <typename Event>
+    static void handleRecorded(Pool& pool, id_type id, const std::byte* payload) {
+        Event event;
+        std::memcpy(&event, payload, sizeof(event));
+        pool.handle(id, event);
+    }
+
+    constexpr static std::array<std::size_t, sizeof...(Events)> sizes = {{sizeof(Events)...}};
+    constexpr static std::array<void (*)(Pool&, id_type, const std::byte*), sizeof...(Events)> handlers = {
+        {&handleRecorded<Events>...}};
+
+    const PartitionMap& map;
+    node_type self;
+    Pool& pool;
+    std::vector<status> statuses;
+    std::vector<std::size_t> incoming;
+    std::unordered_map<std::size_t, std::vector<std::byte>> pending;
+};
+
+}  // End of namespace fsm
@@ -0,0 +1,310 @@
+#pragma once
+
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <limits>
+#include <tuple>
+#include <type_traits>
+#include <utility>
+#include <variant>
+#include <vector>
+
+#include "policies/Observer.hpp"
+#include "tools/MpscRing.hpp"
+#include "tools/SeqlockCell.hpp"
+#include "tools/Span.hpp"
+#include "tools/StateTraits.hpp"
+#include "tools/TypeIndex.hpp"
+
+namespace fsm {
+
+/**
+ * @brief How a QueuedMachine queues one event type.
+ */
+enum class queue_mode {
+    /// Every event takes a slot in the queue.
+    enqueue,
+    /// An event is dropped while another event of its type is queued.
+    drop_duplicates,
+    /// Events of the type take at most one slot, and the machine gets the latest one posted.
+    coalesce_latest,
+};
+
+/**
+ * @brief Queueing traits of Event, to specialize with a mode and/or a priority member.
+ * @details Events with a higher priority are handed to the machine before the queued events
+ * with a lower one; the default is the enqueue mode and priority 0.
+ * @code
+ * namespace fsm {
+ * template <>
+ * struct queue_traits<LockEvent> {
+ *     static constexpr std::size_t priority = 1;
+ * };
+ * template <>
+ * struct queue_traits<StatusUpdate> {
+ *     static constexpr queue_mode mode = queue_mode::coalesce_latest;
+ * };
+ * }
+ * @endcode
+ */
+template <typename Event>
+struct queue_traits {
+};
+
+template <typename Event, typename = void>
+struct queue_mode_of : std::integral_constant<queue_mode, queue_mode::enqueue> {
+};
+
+template <typename Event>
+struct queue_mode_of<Event, std::void_t<decltype(queue_traits<Event>::mode)>>
+    : std::integral_constant<queue_mode, queue_traits<Event>::mode> {
+};
+
+template <typename Event>
+constexpr queue_mode queue_mode_v = queue_mode_of<Event>::value;
+
+template <typename Event, typename = void>
+struct queue_priority_of : std::integral_constant<std::size_t, 0> {
+};
+
+template <typename Event>
+struct queue_priority_of<Event, std::void_t<decltype(queue_traits<Event>::priority)>>
+    : std::integral_constant<std::size_t, queue_traits<Event>::priority> {
+};
+
+template <typename Event>
+constexpr std::size_t queue_priority_v = queue_priority_of<Event>::value;
+
+/**
+ * @brief Lock-free event queue in front of a single-threaded machine.
+ * @details Any number of producer threads post events into bounded multi-producer
+ * single-consumer rings of std::variant<Events...>, without ever blocking on the machine. The
+ * thread owning the machine calls drain(), which hands the queued events to
+ * Machine::handleBatch in batches.
+ *
+ * There is one ring, or lane, per priority of queue_traits, each of the given capacity; every
+ * batch is filled from the highest priority lanes first, so urgent events skip ahead of bulk
+ * traffic (and may starve it). Events keep their order within a lane. Events in the
+ * drop_duplicates or coalesce_latest mode are coalesced in post(), with one atomic flag per
+ * type claimed before its event is pushed, so that neither posters nor drain() ever wait on
+ * each other; coalesce_latest events must be trivially copyable, the latest one being kept in
+ * a SeqlockCell read when its slot is dequeued.
+ * @tparam Machine : wrapped machine type.
+ * @tparam Events : events accepted by the queue.
+ */
+template <class Machine, class... Events>
+class QueuedMachine {
+public:
+    using event_type = std::variant<Events...>;
+
+    static constexpr std::size_t defaultBatchSize = 256;
+
+    /**
+     * @brief Number of priority lanes.
+     */
+    static constexpr std::size_t lane_count = std::max({std::size_t{0}, queue_priority_v<Events>...}) + 1;
+
+    /**
+     * @param[in] capacity : number of events each lane can hold, rounded up to a power of two.
+     * @param[in] args : arguments forwarded to the constructor of the machine.
+     */
+    template <typename... Args>
+    explicit QueuedMachine(std::size_t capacity, Args&&... args)
+        : machineInstance(std::forward<Args>(args)...),
+          lanes(makeLanes(capacity, std::make_index_sequence<lane_count>{})),
+          batch(defaultBatchSize) {
+    }
+
+    /**
+     * @brief Queue an event, from any thread.
+     * @details Events no state of the machine reacts to are dropped right away (unless the
+     * machine observes them), without taking a slot in the queue, like duplicates of a queued
+     * drop_duplicates event. A coalesce_latest event replaces the pending one of its type. A
+     * std::variant is posted as its current alternative.
+     * @return false when the lane of the event is full, the event is then dropped. Duplicates
+     * posted while the event claiming their slot finds the lane full return true, and are
+     * dropped with it: the lane had no room for them either.
+     */
+    template <typename Event>
+    bool post(Event&& event) {
+        using posted_type = std::decay_t<Event>;
+        constexpr std::size_t index = type_index_v<posted_type, Events...>;
+        if constexpr (index < sizeof...(Events)) {
+            if constexpr (!is_observed_v<Machine> && is_noop_v<Machine, posted_type>) {
+                return true;
+            }
+            auto& lane = lanes[queue_priority_v<posted_type>];
+            constexpr queue_mode mode = queue_mode_v<posted_type>;
+            if constexpr (mode == queue_mode::enqueue) {
+                return lane.tryPush(event_type{std::in_place_index<index>, std::forward<Event>(event)});
+            } else {
+                auto& slot = std::get<index>(slots);
+                if constexpr (mode == queue_mode::coalesce_latest) {
+                    // A failed store was superseded by a concurrent one.
+                    slot.latest.tryStore(event);
+                }
+                if (slot.queued.exchange(true, std::memory_order_acq_rel)) {
+                    return true;
+                }
+                if (!lane.tryPush(event_type{std::in_place_index<index>, std::forward<Event>(event)})) {
+                    slot.queued.store(false, std::memory_order_release);
+                    return false;
+                }
+                return true;
+            }
+        } else if constexpr (is_variant<posted_type>::value) {
+            return std::visit(
+                [this](auto&& alternative) { return post(std::forward<decltype(alternative)>(alternative)); },
+                std::forward<Event>(event));
+        } else {
+            static_assert(index < sizeof...(Events), "event not accepted by this QueuedMachine");
+        }
+    }
+
+    /**
+     * @brief Handle queued events on the thread owning the machine.
+     * @param[in] maxEvents : upper bound on the number of events dequeued.
+     * @return Number of events handled.
+     */
+    std::size_t drain(std::size_t maxEvents = std::numeric_limits<std::size_t>::max()) {
+        std::size_t dequeued = 0;
+        std::size_t handled = 0;
+        while (dequeued < maxEvents) {
+            const std::size_t wanted = std::min(batch.size(), maxEvents - dequeued);
+            std::size_t popped = 0;
+            for (std::size_t lane = lane_count; lane-- > 0 && popped < wanted;) {
+                popped += lanes[lane].popBatch(batch.data() + popped, wanted - popped);
+            }
+            if (popped == 0) {
+                break;
+            }
+            dequeued += popped;
+            const std::size_t count = has_coalescing ? settle(popped) : popped;
+            if (count > 0) {
+                machineInstance.handleBatch(span<const event_type>(batch.data(), count));
+            }
+            handled += count;
+        }
+        return handled;
+    }
+
+    /**
+     * @brief Set how many events drain() hands to the machine at once.
+     */
+    void setBatchSize(std::size_t size) {
+        batch.resize(size == 0 ? 1 : size);
+    }
+
+    bool empty() const {
+        return std::all_of(lanes.begin(), lanes.end(), [](const auto& lane) { return lane.empty(); });
+    }
+
+    Machine& machine() noexcept {
+        return machineInstance;
+    }
+
+    const Machine& machine() const noexcept {
+        return machineInstance;
+    }
+
+private:
+    using lane_type = MpscRing<event_type>;
+
+    static constexpr bool has_coalescing = ((queue_mode_v<Events> != queue_mode::enqueue) || ...);
+
+    template <typename Event>
+    struct is_variant : std::false_type {
+    };
+
+    template <typename... Alternatives>
+    struct is_variant<std::variant<Alternatives...>> : std::true_type {
+    };
+
+    template <std::size_t... Lanes>
+    static std::array<lane_type, lane_count> makeLanes(std::size_t capacity, std::index_sequence<Lanes...>) {
+        return {{((void)Lanes, lane_type(capacity))...}};
+    }
+
+    /**
+     * @brief Coalescing state of one event type, empty in the enqueue mode.
+     */
+    template <typename Event, queue_mode = queue_mode_v<Event>>
+    struct slot_type {
+    };
+
+    template <typename Event>
+    struct slot_type<Event, queue_mode::drop_duplicates> {
+        std::atomic<bool> queued{false};
+    };
+
+    template <typename Event>
+    struct slot_type<Event, queue_mode::coalesce_latest> {
+        std::atomic<bool> queued{false};
+        SeqlockCell<Event> latest;
+        std::uint64_t consumed = 0;
+    };
+
+    /**
+     * @brief Clear the queued flag of the coalesced events among the popped ones, replace
+     * coalesce_latest events with the latest value of their type and drop the ones already
+     * handled, in place.
+     * @return Number of events left in the batch.
+     */
+    std::size_t settle(std::size_t popped) {
+        std::size_t kept = 0;
+        for (std::size_t i = 0; i < popped; ++i) {
+            if (settle_table[batch[i].index()](*this, batch[i])) {
+                if (kept != i) {
+                    batch[kept] = std::move(batch[i]);
+                }
+                ++kept;
+            }
+        }
+        return kept;
+    }
+
+    template <std::size_t Ind>
+    static bool settleEvent(QueuedMachine& self, event_type& event) {
+        using Event = std::tuple_element_t<Ind, std::tuple<Events...>>;
+        constexpr queue_mode mode = queue_mode_v<Event>;
+        if constexpr (mode == queue_mode::drop_duplicates) {
+            std::get<Ind>(self.slots).queued.store(false, std::memory_order_release);
+        } else if constexpr (mode == queue_mode::coalesce_latest) {
+            auto& slot = std::get<Ind>(self.slots);
+            slot.queued.exchange(false, std::memory_order_acq_rel);
+            Event latest;
+            const std::uint64_t version = slot.latest.load(latest);
+            if (version == slot.consumed) {
+                return false;
+            }
+            slot.consumed = version;
+            event.template emplace<Ind>(latest);
+        } else {
+            (void)self;
+            (void)event;
+        }
+        return true;
+    }
+
+    template <typename = std::index_sequence_for<Events...>>
+    struct settle_table_of;
+
+    template <std::size_t... Idxs>
+    struct settle_table_of<std::index_sequence<Idxs...>> {
+        using settle_fun_ptr = bool (*)(QueuedMachine&, event_type&);
+
+        constexpr static std::array<settle_fun_ptr, sizeof...(Idxs)> lookup_table = {{&settleEvent<Idxs>...}};
+    };
+
+    static constexpr const auto& settle_table = settle_table_of<>::lookup_table;
+
+    Machine machineInstance;
+    std::array<lane_type, lane_count> lanes;
+    std::tuple<slot_type<Events>...> slots;
+    std::vector<event_type> batch;
+};
+
+}  // End of namespace fsm
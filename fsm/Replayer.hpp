@@ -0,0 +1,132 @@
+#pragma once
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <tuple>
+#include <type_traits>
+#include <utility>
+#include <variant>
+#include <vector>
+
+#include "tools/EventLog.hpp"
+#include "tools/Span.hpp"
+
+namespace fsm {
+
+/**
+ * @brief Plays an event log written by a Recorder back into a machine, as fast as it goes.
+ * @details A BasicStateMachine gets every record through handleTagged, which copies the event
+ * out of the mapped log and dispatches it with a single lookup in the [event][state] table.
+ * Other machines (e.g. a QueuedMachine) get the records decoded into a reused batch of
+ * std::variant<Events...> handed to handleBatch. Either way replaying allocates nothing once
+ * the batch is sized. Timestamps are not waited for. Events must be listed as they were for the
+ * Recorder.
+ * @code
+ * fsm::Replayer<OpenEvent, CloseEvent, LockEvent, UnlockEvent> replayer;
+ * if (replayer.open("door.log")) {
+ *     replayer.replay(door);
+ * }
+ * @endcode
+ * @tparam Events : recorded events, trivially copyable and default constructible.
+ */
+template <typename... Events>
+class Replayer {
+    static_assert(((std::is_trivially_copyable_v<Events> && std::is_default_constructible_v<Events>) && ...),
+                  "replayed events are copied from their bytes");
+
+public:
+    using event_type = std::variant<Events...>;
+
+    /**
+     * @param[in] batchSize : number of events decoded before each handleBatch, for machines
+     * without handleTagged.
+     */
+    explicit Replayer(std::size_t batchSize = 256) : batchSize(batchSize > 0 ? batchSize : 1) {
+        batch.reserve(this->batchSize);
+    }
+
+    bool open(const char* path) noexcept {
+        return reader.open(path);
+    }
+
+    /**
+     * @brief Replay the log held by bytes, which must outlive the replayer.
+     */
+    bool open(span<const std::byte> bytes) noexcept {
+        return reader.open(bytes);
+    }
+
+    std::uint64_t count() const noexcept {
+        return reader.count();
+    }
+
+    /**
+     * @brief Handle every recorded event with machine, in order.
+     * @return false when replay stopped at a record which is malformed or not one of Events; the
+     * events before it have been handled.
+     */
+    template <typename Machine>
+    bool replay(Machine& machine) {
+        batch.clear();
+        auto decode = [this, &machine](const event_log_record& record, span<const std::byte> payload) {
+            if (record.type >= sizeof...(Events) || record.size != sizes[record.type]) {
+                return false;
+            }
+            if constexpr (has_handle_tagged<Machine>::value) {
+                machine.template handleTagged<Events...>(record.type, payload);
+            } else {
+                decoders[record.type](batch, payload.data());
+                if (batch.size() == batchSize) {
+                    flush(machine);
+                }
+            }
+            return true;
+        };
+        const bool complete = reader.forEach(decode);
+        flush(machine);
+        return complete;
+    }
+
+private:
+    template <typename Machine, typename = void>
+    struct has_handle_tagged : std::false_type {
+    };
+
+    template <typename Machine>
+    struct has_handle_tagged<Machine,
+                             std::void_t<decltype(std::declval<Machine&>().template handleTagged<Events...>(
+                                 std::size_t{}, std::declval<span<const std::byte>>()))>> : std::true_type {
+    };
+
+    template <typename Machine>
+    void flush(Machine& machine) {
+        if (!batch.empty()) {
+            machine.handleBatch(span<const event_type>(batch.data(), batch.size()));
+            batch.clear();
+        }
+    }
+
+    template <std::size_t Ind>
+    static void decode(std::vector<event_type>& batch, const std::byte* bytes) {
+        std::tuple_element_t<Ind, std::tuple<Events...>> event;
+        std::memcpy(&event, bytes, sizeof(event));
+        batch.emplace_back(std::in_place_index<Ind>, event);
+    }
+
+    template <std::size_t... Idxs>
+    static constexpr auto makeDecoders(std::index_sequence<Idxs...>) {
+        using decode_fun_ptr = void (*)(std::vector<event_type>&, const std::byte*);
+        return std::array<decode_fun_ptr, sizeof...(Events)>{{&decode<Idxs>...}};
+    }
+
+    static constexpr std::array<std::uint32_t, sizeof...(Events)> sizes = {{sizeof(Events)...}};
+    static constexpr auto decoders = makeDecoders(std::index_sequence_for<Events...>{});
+
+    EventLogReader reader;
+    std::vector<event_type> batch;
+    std::size_t batchSize;
+};
+
+}  // End of namespace fsm
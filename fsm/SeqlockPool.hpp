@@ -0,0 +1,168 @@
+#pragma once
+
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <memory>
+#include <new>
+#include <stdexcept>
+#include <type_traits>
+#include <utility>
+
+#include "MachinePool.hpp"
+
+namespace fsm {
+
+/**
+ * @brief MachinePool whose machines can be read by other threads while one thread drives them,
+ * the SeqlockReads counterpart for pools.
+ * @details Each machine publishes its state index in an atomic after every event, so that
+ * currentIndex(id) is wait-free from any thread. Machines are spread over Stripes sequence
+ * numbers, bumped around every event as for SeqlockReads, so that tryReadState<State>(id, fn)
+ * retries on a torn copy, while handling events in other stripes does not disturb it. The pool
+ * is sized once: machines are added by the driver before readers start, up to the capacity.
+ * @tparam Pool : MachinePool of trivially copyable states.
+ * @tparam Stripes : number of sequence numbers, each on its own cache line.
+ */
+template <class Pool, std::size_t Stripes = 64>
+class SeqlockPool {
+public:
+    using id_type = typename Pool::id_type;
+    using index_type = typename Pool::index_type;
+
+    /**
+     * @param[in] capacity : maximum number of machines.
+     * @param[in] args : arguments forwarded to the constructor of the pool.
+     */
+    template <typename... Args>
+    explicit SeqlockPool(std::size_t capacity, Args&&... args)
+        : pool(std::forward<Args>(args)...), published(new std::atomic<index_type>[capacity]), capacity(capacity) {
+        pool.reserve(capacity);
+    }
+
+    SeqlockPool(const SeqlockPool&) = delete;
+    SeqlockPool& operator=(const SeqlockPool&) = delete;
+
+    /**
+     * @brief Add a machine built from the prototype states, on the driver thread.
+     * @return Id of the new machine. Throws std::length_error beyond the capacity.
+     */
+    id_type add() {
+        if (pool.size() == capacity) {
+            throw std::length_error("SeqlockPool is full");
+        }
+        const id_type id = pool.add();
+        published[id].store(static_cast<index_type>(pool.currentIndex(id)), std::memory_order_release);
+        return id;
+    }
+
+    std::size_t size() const noexcept {
+        return pool.size();
+    }
+
+    /**
+     * @brief Index of the current state of a machine, from any thread.
+     */
+    std::size_t currentIndex(id_type id) const noexcept {
+        return published[id].load(std::memory_order_acquire);
+    }
+
+    /**
+     * @brief Handle event in machine id, on the driver thread.
+     */
+    template <typename Event>
+    void handle(id_type id, const Event& event) {
+        auto& stripe = stripes[id % Stripes].sequence;
+        beginWrite(stripe);
+        pool.handle(id, event);
+        publish(id);
+        endWrite(stripe);
+    }
+
+    /**
+     * @brief Handle Timeout in the machines whose timer expired, on the driver thread.
+     */
+    template <typename Rep, typename Period>
+    std::size_t tick(std::chrono::duration<Rep, Period> now) {
+        return pool.tick(now, [this](id_type id) { handle(id, Timeout{}); });
+    }
+
+    /**
+     * @brief Call reader with a consistent copy of State when machine id is in State, from any
+     * thread, retrying while the copy may have been torn.
+     * @return false when the machine is not in State; reader is then not called.
+     */
+    template <typename State, typename Reader>
+    bool tryReadState(id_type id, Reader&& reader) const {
+        static_assert(std::is_trivially_copyable_v<State>, "states read from other threads are copied");
+        constexpr std::size_t stateIndex = states_of<Pool>::template index<State>;
+        const auto& stripe = stripes[id % Stripes].sequence;
+        alignas(State) unsigned char copy[sizeof(State)];
+        for (;;) {
+            const std::uint64_t before = stripe.load(std::memory_order_acquire);
+            if (before & 1) {
+                continue;
+            }
+            const bool inState = currentIndex(id) == stateIndex;
+            if (inState) {
+                std::memcpy(copy, &pool.template state<State>(id), sizeof(State));
+            }
+            std::atomic_thread_fence(std::memory_order_acquire);
+            if (stripe.load(std::memory_order_relaxed) == before) {
+                if (inState) {
+                    reader(*std::launder(reinterpret_cast<const State*>(copy)));
+                }
+                return inState;
+            }
+        }
+    }
+
+    /**
+     * @brief The pool itself, for the driver thread; events handled straight through it are not
+     * published.
+     */
+    Pool& machines() noexcept {
+        return pool;
+    }
+
+    const Pool& machines() const noexcept {
+        return pool;
+    }
+
+private:
+    template <class P>
+    struct states_of;
+
+    template <class... States>
+    struct states_of<MachinePool<States...>> {
+        template <typename State>
+        static constexpr std::size_t index = type_index_v<State, States...>;
+    };
+
+    struct alignas(64) stripe_type {
+        std::atomic<std::uint64_t> sequence{0};
+    };
+
+    static void beginWrite(std::atomic<std::uint64_t>& stripe) noexcept {
+        stripe.store(stripe.load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+        std::atomic_thread_fence(std::memory_order_release);
+    }
+
+    static void endWrite(std::atomic<std::uint64_t>& stripe) noexcept {
+        stripe.store(stripe.load(std::memory_order_relaxed) + 1, std::memory_order_release);
+    }
+
+    void publish(id_type id) noexcept {
+        published[id].store(static_cast<index_type>(pool.currentIndex(id)), std::memory_order_release);
+    }
+
+    Pool pool;
+    std::unique_ptr<std::atomic<index_type>[]> published;
+    std::size_t capacity;
+    std::array<stripe_type, Stripes> stripes;
+};
+
+}  // End of namespace fsm
@@ -0,0 +1,276 @@
+#pragma once
+
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+#include "QueuedMachine.hpp"
+#include "tools/MpmcRing.hpp"
+
+namespace fsm {
+
+/**
+ * @brief Runs a fleet of machines on a fixed number of worker threads.
+ * @details Machine ids are hashed to shards, one per worker. Every machine has its own
+ * QueuedMachine mailbox, and a machine with pending events is scheduled, at most once at a
+ * time, on the lock-free ready ring of its shard. Only the worker holding a scheduled machine
+ * touches it, so all events of one machine are handled in order, on one core at a time, and
+ * without locking. A worker whose own ring is empty may steal a whole scheduled machine from
+ * another shard, never single events. A machine handles at most drain_budget events each time
+ * it runs, then goes back to the end of the ready ring if more are pending, so that a machine
+ * flooded with events does not starve the others of its shard. An idle worker spins a little,
+ * then parks until a machine of its shard is scheduled (on std::atomic::wait in C++20, a
+ * condition variable before).
+ *
+ * Machines are added with add() before start(); the set of machines is fixed while workers run.
+ * @tparam Machine : machine type, must provide handleBatch.
+ * @tparam Events : events accepted by the machines.
+ */
+template <class Machine, class... Events>
+class ShardedExecutor {
+public:
+    using id_type = std::uint64_t;
+
+    /**
+     * @param[in] shardCount : number of shards, hence of worker threads.
+     * @param[in] mailboxCapacity : number of events each machine can have pending.
+     */
+    explicit ShardedExecutor(std::size_t shardCount, std::size_t mailboxCapacity = 64)
+        : shards(shardCount == 0 ? 1 : shardCount), mailboxCapacity(mailboxCapacity) {
+    }
+
+    ShardedExecutor(const ShardedExecutor&) = delete;
+    ShardedExecutor& operator=(const ShardedExecutor&) = delete;
+
+    ~ShardedExecutor() {
+        stop();
+    }
+
+    /**
+     * @brief Create the machine with the given id, only while stopped.
+     * @param[in] args : arguments forwarded to the constructor of the machine.
+     * @return The new machine.
+     */
+    template <typename... Args>
+    Machine& add(id_type id, Args&&... args) {
+        const std::size_t home = shardOf(id);
+        auto slot = std::make_unique<Slot>(home, mailboxCapacity, std::forward<Args>(args)...);
+        Machine& machine = slot->mailbox.machine();
+        shards[home].machines[id] = std::move(slot);
+        return machine;
+    }
+
+    /**
+     * @brief Access a machine, only while stopped.
+     * @return Machine with the given id, or nullptr.
+     */
+    Machine* find(id_type id) {
+        Slot* slot = findSlot(id);
+        return slot ? &slot->mailbox.machine() : nullptr;
+    }
+
+    /**
+     * @brief Queue an event for a machine, from any thread.
+     * @return false when the id is unknown or the mailbox of the machine is full.
+     */
+    template <typename Event>
+    bool post(id_type id, Event&& event) {
+        Slot* slot = findSlot(id);
+        if (!slot || !slot->mailbox.post(std::forward<Event>(event))) {
+            return false;
+        }
+        schedule(*slot);
+        return true;
+    }
+
+    /**
+     * @brief Start one worker thread per shard.
+     */
+    void start() {
+        if (running.load()) {
+            return;
+        }
+        for (Shard& shard : shards) {
+            shard.ready = std::make_unique<MpmcRing<Slot*>>(shard.machines.size());
+            for (auto& machine : shard.machines) {
+                machine.second->scheduled.store(false, std::memory_order_relaxed);
+            }
+        }
+        running.store(true);
+        for (Shard& shard : shards) {
+            for (auto& machine : shard.machines) {
+                if (!machine.second->mailbox.empty()) {
+                    schedule(*machine.second);
+                }
+            }
+        }
+        for (std::size_t i = 0; i < shards.size(); ++i) {
+            shards[i].worker = std::thread([this, i] { work(i); });
+        }
+    }
+
+    /**
+     * @brief Stop and join the worker threads.
+     * @details Events still pending stay in the mailboxes and are handled after the next start().
+     */
+    void stop() {
+        if (!running.exchange(false)) {
+            return;
+        }
+        for (Shard& shard : shards) {
+            wake(shard);
+        }
+        for (Shard& shard : shards) {
+            shard.worker.join();
+        }
+    }
+
+    std::size_t shardCount() const noexcept {
+        return shards.size();
+    }
+
+    std::size_t shardOf(id_type id) const noexcept {
+        id ^= id >> 33;
+        id *= 0xff51afd7ed558ccdULL;
+        id ^= id >> 33;
+        return static_cast<std::size_t>(id % shards.size());
+    }
+
+private:
+    struct Slot {
+        template <typename... Args>
+        Slot(std::size_t home, std::size_t capacity, Args&&... args)
+            : home(home), mailbox(capacity, std::forward<Args>(args)...) {
+        }
+
+        const std::size_t home;
+        QueuedMachine<Machine, Events...> mailbox;
+        std::atomic<bool> scheduled{false};
+    };
+
+    struct Shard {
+        std::unordered_map<id_type, std::unique_ptr<Slot>> machines;
+        std::unique_ptr<MpmcRing<Slot*>> ready;
+        std::thread worker;
+        /// Bumped whenever a machine is scheduled on the shard, or the executor stops.
+        std::atomic<std::uint32_t> signal{0};
+        std::atomic<std::uint32_t> sleepers{0};
+#if !defined(__cpp_lib_atomic_wait)
+        std::mutex mutex;
+        std::condition_variable wakeup;
+#endif
+    };
+
+    /**
+     * @brief Number of times an idle worker yields before parking.
+     */
+    static constexpr unsigned spin_limit = 64;
+
+    /**
+     * @brief Number of events a machine handles each time a worker runs it.
+     */
+    static constexpr std::size_t drain_budget = 256;
+
+    Slot* findSlot(id_type id) {
+        auto& machines = shards[shardOf(id)].machines;
+        auto found = machines.find(id);
+        return found == machines.end() ? nullptr : found->second.get();
+    }
+
+    void schedule(Slot& slot) {
+        if (!slot.scheduled.exchange(true) && running.load(std::memory_order_relaxed)) {
+            Shard& shard = shards[slot.home];
+            shard.ready->tryPush(&slot);
+            wake(shard);
+        }
+    }
+
+    /**
+     * @brief Wake the worker of shard if it is parked; seen by a worker about to park as well,
+     * which then does not.
+     */
+    void wake(Shard& shard) {
+        shard.signal.fetch_add(1);
+        if (shard.sleepers.load() == 0) {
+            return;
+        }
+#if defined(__cpp_lib_atomic_wait)
+        shard.signal.notify_all();
+#else
+        {
+            const std::lock_guard<std::mutex> lock{shard.mutex};
+        }
+        shard.wakeup.notify_all();
+#endif
+    }
+
+    /**
+     * @brief Park the calling worker until the signal of its shard moves on from seen.
+     */
+    void park(Shard& shard, std::uint32_t seen) {
+#if defined(__cpp_lib_atomic_wait)
+        shard.sleepers.fetch_add(1);
+        shard.signal.wait(seen);
+        shard.sleepers.fetch_sub(1);
+#else
+        std::unique_lock<std::mutex> lock{shard.mutex};
+        shard.sleepers.fetch_add(1);
+        shard.wakeup.wait(lock, [&shard, seen] { return shard.signal.load() != seen; });
+        shard.sleepers.fetch_sub(1);
+#endif
+    }
+
+    void run(Slot& slot) {
+        slot.mailbox.drain(drain_budget);
+        slot.scheduled.store(false);
+        std::atomic_thread_fence(std::memory_order_seq_cst);
+        if (!slot.mailbox.empty()) {
+            schedule(slot);
+        }
+    }
+
+    bool steal(std::size_t thief, Slot*& slot) {
+        for (std::size_t i = 1; i < shards.size(); ++i) {
+            if (shards[(thief + i) % shards.size()].ready->tryPop(slot)) {
+                return true;
+            }
+        }
+        return false;
+    }
+
+    void work(std::size_t index) {
+        Shard& shard = shards[index];
+        MpmcRing<Slot*>& ready = *shard.ready;
+        Slot* slot = nullptr;
+        unsigned idle = 0;
+        for (;;) {
+            // Read before running and the lookup: a later stop() or schedule() moves it on.
+            const std::uint32_t seen = shard.signal.load();
+            if (!running.load(std::memory_order_relaxed)) {
+                break;
+            }
+            if (ready.tryPop(slot) || steal(index, slot)) {
+                run(*slot);
+                idle = 0;
+            } else if (++idle < spin_limit) {
+                std::this_thread::yield();
+            } else {
+                park(shard, seen);
+                idle = 0;
+            }
+        }
+    }
+
+    std::vector<Shard> shards;
+    const std::size_t mailboxCapacity;
+    std::atomic<bool> running{false};
+};
+
+}  // End of namespace fsm
@@ -0,0 +1,373 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <type_traits>
+#include <utility>
+
+#include "MachinePool.hpp"
+#include "StateMachine.hpp"
+#include "tools/Span.hpp"
+#include "tools/StateIndex.hpp"
+#include "tools/TypeIndex.hpp"
+
+namespace fsm {
+
+/**
+ * @brief Header opening every snapshot.
+ * @details Fields are in host byte order; a snapshot taken on a host of the other endianness
+ * is rejected through its magic.
+ */
+struct snapshot_header {
+    std::uint32_t magic;
+    std::uint16_t version;
+    std::uint16_t stateCount;
+    std::uint32_t layout;
+    std::uint32_t reserved;
+    std::uint64_t count;
+};
+
+constexpr std::uint32_t snapshot_magic = 0x534d5346;  // "FSMS"
+constexpr std::uint16_t snapshot_version = 1;
+
+/**
+ * @brief Flat layout of a snapshot of count machines sharing States.
+ * @details The header is followed by the state index of every machine, then by one column per
+ * non-empty state holding its payload for every machine, each section starting on a
+ * section_alignment boundary. A single machine is stored as a pool of one, so the layout can be
+ * written to a file and mapped back as is. The layout fingerprint covers the index width and the
+ * size and alignment of every state, not the state types themselves.
+ * @tparam States : states of the machines, all trivially copyable.
+ */
+template <class... States>
+struct snapshot_layout {
+    static_assert((std::is_trivially_copyable_v<States> && ...), "snapshot states must be trivially copyable");
+
+    using index_type = state_index_t<sizeof...(States)>;
+
+    static constexpr std::size_t state_count = sizeof...(States);
+    static constexpr std::size_t section_alignment = 16;
+
+    template <typename State>
+    static constexpr std::size_t payload_size = std::is_empty_v<State> ? 0 : sizeof(State);
+
+    static constexpr std::uint32_t fingerprint() {
+        constexpr std::size_t fields[] = {sizeof(index_type), payload_size<States>..., alignof(States)...};
+        std::uint32_t hash = 2166136261u;
+        for (const std::size_t field : fields) {
+            hash = (hash ^ static_cast<std::uint32_t>(field)) * 16777619u;
+        }
+        return hash;
+    }
+
+    static constexpr std::size_t align(std::size_t offset) {
+        return (offset + section_alignment - 1) & ~(section_alignment - 1);
+    }
+
+    static constexpr std::size_t indices_offset() {
+        return align(sizeof(snapshot_header));
+    }
+
+    /**
+     * @brief Offset of the column of the state at position Ind.
+     */
+    template <std::size_t Ind>
+    static constexpr std::size_t column_offset(std::size_t count) {
+        constexpr std::size_t sizes[] = {payload_size<States>...};
+        std::size_t offset = align(indices_offset() + count * sizeof(index_type));
+        for (std::size_t i = 0; i < Ind; ++i) {
+            offset = align(offset + count * sizes[i]);
+        }
+        return offset;
+    }
+
+    static constexpr std::size_t size(std::size_t count) {
+        return column_offset<state_count>(count);
+    }
+
+    static snapshot_header header(std::size_t count) {
+        return {snapshot_magic, snapshot_version, static_cast<std::uint16_t>(state_count), fingerprint(), 0,
+                static_cast<std::uint64_t>(count)};
+    }
+
+    /**
+     * @brief Check that the header and the indices of in match this layout.
+     * @param[out] count : number of machines in the snapshot.
+     * @return false for a truncated, malformed or foreign snapshot.
+     */
+    static bool validate(span<const std::byte> in, std::size_t& count) noexcept {
+        if (in.size() < size(0)) {
+            return false;
+        }
+        snapshot_header header;
+        std::memcpy(&header, in.data(), sizeof(header));
+        if (header.magic != snapshot_magic || header.version != snapshot_version ||
+            header.stateCount != state_count || header.layout != fingerprint() ||
+            header.count > (in.size() - indices_offset()) / sizeof(index_type) ||
+            in.size() < size(static_cast<std::size_t>(header.count))) {
+            return false;
+        }
+        count = static_cast<std::size_t>(header.count);
+        const std::byte* indices = in.data() + indices_offset();
+        for (std::size_t i = 0; i < count; ++i) {
+            index_type index;
+            std::memcpy(&index, indices + i * sizeof(index_type), sizeof(index_type));
+            if (index >= state_count) {
+                return false;
+            }
+        }
+        return true;
+    }
+};
+
+/**
+ * @brief Reaches the storage of machines and pools on behalf of the snapshot functions.
+ */
+struct snapshot_access {
+    template <class Policy, class... States>
+    static std::size_t index(const BasicStateMachine<Policy, States...>& machine) noexcept {
+        return machine.index();
+    }
+
+    template <typename State, class Policy, class... States>
+    static State& state(BasicStateMachine<Policy, States...>& machine) noexcept {
+        using std::get;
+        return get<State>(machine.states);
+    }
+
+    template <typename State, class Policy, class... States>
+    static const State& state(const BasicStateMachine<Policy, States...>& machine) noexcept {
+        using std::get;
+        return get<State>(machine.states);
+    }
+
+    /**
+     * @brief Run write() inside a write section of machine, retried by its readers on other
+     * threads when the concurrency policy publishes the state.
+     */
+    template <class Policy, class... States, typename Write>
+    static void writing(BasicStateMachine<Policy, States...>& machine, Write&& write) {
+        machine.publishing(std::forward<Write>(write));
+    }
+
+    template <class... States>
+    static auto& indices(MachinePool<States...>& pool) noexcept {
+        return pool.indices;
+    }
+
+    template <class... States>
+    static const auto& indices(const MachinePool<States...>& pool) noexcept {
+        return pool.indices;
+    }
+
+    template <typename State, class... States>
+    static auto& column(MachinePool<States...>& pool) noexcept {
+        return get<PoolColumn<State>>(pool.columns);
+    }
+
+    template <typename State, class... States>
+    static const auto& column(const MachinePool<States...>& pool) noexcept {
+        return get<PoolColumn<State>>(pool.columns);
+    }
+
+    template <class... States>
+    static void resetTimers(MachinePool<States...>& pool, std::size_t first, std::size_t count) {
+        pool.resetTimers(first, count);
+    }
+
+    template <class... States>
+    static void cancelTimers(MachinePool<States...>& pool, std::size_t first, std::size_t count) noexcept {
+        pool.cancelTimers(first, count);
+    }
+};
+
+/**
+ * @brief Grow pool to size machines built from its prototypes, their timers armed as by add().
+ * @details Everything is allocated first: a throw leaves pool untouched.
+ */
+template <class... States>
+void grow(MachinePool<States...>& pool, std::size_t size) {
+    if (pool.size() < size) {
+        pool.reserve(size);
+        while (pool.size() < size) {
+            pool.add();
+        }
+    }
+}
+
+template <class Policy, class... States>
+constexpr std::size_t snapshot_size(const BasicStateMachine<Policy, States...>&) noexcept {
+    return snapshot_layout<States...>::size(1);
+}
+
+template <class... States>
+std::size_t snapshot_size(const MachinePool<States...>& pool) noexcept {
+    return snapshot_layout<States...>::size(pool.size());
+}
+
+/**
+ * @brief Write the current state index and the payload of every state of machine into out.
+ * @return Number of bytes written, 0 when out is smaller than snapshot_size(machine).
+ */
+template <class Policy, class... States>
+std::size_t serialize(const BasicStateMachine<Policy, States...>& machine, span<std::byte> out) noexcept {
+    static_assert(Policy::Storage::keeps_all_states, "snapshots hold every state of the machine");
+    using layout = snapshot_layout<States...>;
+    constexpr std::size_t size = layout::size(1);
+    if (out.size() < size) {
+        return 0;
+    }
+    std::memset(out.data(), 0, size);
+    const snapshot_header header = layout::header(1);
+    std::memcpy(out.data(), &header, sizeof(header));
+    const auto index = static_cast<typename layout::index_type>(snapshot_access::index(machine));
+    std::memcpy(out.data() + layout::indices_offset(), &index, sizeof(index));
+    auto writeState = [&machine, &out](auto* tag) {
+        using State = std::remove_pointer_t<decltype(tag)>;
+        if constexpr (!std::is_empty_v<State>) {
+            constexpr std::size_t offset = layout::template column_offset<type_index_v<State, States...>>(1);
+            std::memcpy(out.data() + offset, &snapshot_access::state<State>(machine), sizeof(State));
+        }
+    };
+    (writeState(static_cast<States*>(nullptr)), ...);
+    return size;
+}
+
+/**
+ * @brief Restore machine from a snapshot written by serialize; onLeave/onEnter are not called.
+ * @details The states are copied and the index published inside one write section, so that
+ * tryReadState() on other threads never sees a half-restored machine.
+ * @return false, leaving machine untouched, when in does not hold a valid snapshot of exactly
+ * one machine with the same layout.
+ */
+template <class Policy, class... States>
+bool deserialize(BasicStateMachine<Policy, States...>& machine, span<const std::byte> in) noexcept {
+    static_assert(Policy::Storage::keeps_all_states, "snapshots hold every state of the machine");
+    using layout = snapshot_layout<States...>;
+    std::size_t count = 0;
+    if (!layout::validate(in, count) || count != 1) {
+        return false;
+    }
+    snapshot_access::writing(machine, [&machine, &in] {
+        auto readState = [&machine, &in](auto* tag) {
+            using State = std::remove_pointer_t<decltype(tag)>;
+            if constexpr (!std::is_empty_v<State>) {
+                constexpr std::size_t offset = layout::template column_offset<type_index_v<State, States...>>(1);
+                std::memcpy(&snapshot_access::state<State>(machine), in.data() + offset, sizeof(State));
+            }
+        };
+        (readState(static_cast<States*>(nullptr)), ...);
+        typename layout::index_type index;
+        std::memcpy(&index, in.data() + layout::indices_offset(), sizeof(index));
+        std::size_t position = 0;
+        ((index == position++ ? (void)machine.template transitionTo<States>() : (void)0), ...);
+    });
+    return true;
+}
+
+/**
+ * @brief Write machines [first, first + count) of pool into out, one memcpy per column, as the
+ * snapshot of a pool of count machines.
+ * @return Number of bytes written, 0 when the range is past the end of pool or out is smaller
+ * than snapshot_layout<States...>::size(count).
+ */
+template <class... States>
+std::size_t serialize(const MachinePool<States...>& pool, std::size_t first, std::size_t count,
+                      span<std::byte> out) noexcept {
+    using layout = snapshot_layout<States...>;
+    const std::size_t size = layout::size(count);
+    if (first > pool.size() || count > pool.size() - first || out.size() < size) {
+        return 0;
+    }
+    const snapshot_header header = layout::header(count);
+    std::memset(out.data(), 0, size);
+    std::memcpy(out.data(), &header, sizeof(header));
+    std::memcpy(out.data() + layout::indices_offset(), snapshot_access::indices(pool).data() + first,
+                count * sizeof(typename layout::index_type));
+    auto writeColumn = [&pool, &out, first, count](auto* tag) {
+        using State = std::remove_pointer_t<decltype(tag)>;
+        if constexpr (!std::is_empty_v<State>) {
+            const std::size_t offset = layout::template column_offset<type_index_v<State, States...>>(count);
+            std::memcpy(out.data() + offset, snapshot_access::column<State>(pool).data() + first,
+                        count * sizeof(State));
+        }
+    };
+    (writeColumn(static_cast<States*>(nullptr)), ...);
+    return size;
+}
+
+/**
+ * @brief Write every machine of pool into out, one memcpy per column.
+ * @return Number of bytes written, 0 when out is smaller than snapshot_size(pool).
+ */
+template <class... States>
+std::size_t serialize(const MachinePool<States...>& pool, span<std::byte> out) noexcept {
+    return serialize(pool, 0, pool.size(), out);
+}
+
+/**
+ * @brief Copy the count machines of a validated snapshot over machines [first, first + count)
+ * of pool, which holds them already, and re-arm their timers.
+ */
+template <class... States>
+void restore(MachinePool<States...>& pool, std::size_t first, std::size_t count, span<const std::byte> in) {
+    using layout = snapshot_layout<States...>;
+    std::memcpy(snapshot_access::indices(pool).data() + first, in.data() + layout::indices_offset(),
+                count * sizeof(typename layout::index_type));
+    auto readColumn = [&pool, &in, first, count](auto* tag) {
+        using State = std::remove_pointer_t<decltype(tag)>;
+        if constexpr (!std::is_empty_v<State>) {
+            const std::size_t offset = layout::template column_offset<type_index_v<State, States...>>(count);
+            std::memcpy(snapshot_access::column<State>(pool).data() + first, in.data() + offset,
+                        count * sizeof(State));
+        }
+    };
+    (readColumn(static_cast<States*>(nullptr)), ...);
+    snapshot_access::resetTimers(pool, first, count);
+}
+
+/**
+ * @brief Replace the machines of pool with the ones of a snapshot written by serialize.
+ * @details in may point straight into a memory-mapped file: it is only read with memcpy, so it
+ * needs no particular alignment. The prototypes of pool are kept. Timers are not part of the
+ * snapshot: machines restored in a state with a timeout get a full timeout from the last tick.
+ * @return false, leaving pool untouched, when in does not hold a valid snapshot with the same
+ * layout. Throws std::bad_alloc like MachinePool::reserve, leaving pool untouched too.
+ */
+template <class... States>
+bool deserialize(MachinePool<States...>& pool, span<const std::byte> in) {
+    using layout = snapshot_layout<States...>;
+    std::size_t count = 0;
+    if (!layout::validate(in, count)) {
+        return false;
+    }
+    pool.reserve(count);
+    pool.clear();
+    grow(pool, count);
+    restore(pool, 0, count, in);
+    return true;
+}
+
+/**
+ * @brief Overwrite machines [first, first + count) of pool with the count machines of a snapshot,
+ * e.g. one range of a pool written by serialize(pool, first, count, out).
+ * @details The pool grows when it ends before first + count; machines added to fill a gap
+ * are copies of the prototypes, with their timers armed as by add(). Only the timers of the
+ * range are re-armed.
+ * @return false, leaving pool untouched, when in does not hold a valid snapshot with the same
+ * layout. Throws std::bad_alloc like MachinePool::reserve, leaving pool untouched too.
+ */
+template <class... States>
+bool deserialize(MachinePool<States...>& pool, std::size_t first, span<const std::byte> in) {
+    using layout = snapshot_layout<States...>;
+    std::size_t count = 0;
+    if (!layout::validate(in, count)) {
+        return false;
+    }
+    grow(pool, first + count);
+    restore(pool, first, count, in);
+    return true;
+}
+
+}  // End of namespace fsm
@@ -1,73 +1,534 @@
 #pragma once
 
+#include <array>
+#include <cstddef>
+#include <cstring>
+#include <new>
 #include <tuple>
+#include <type_traits>
+#include <utility>
 #include <variant>
 
-#include "tools/TupleTools.hpp"
+#include "policies/DefaultPolicy.hpp"
+#include "tools/DispatchTable.hpp"
+#include "tools/EventDispatcher.hpp"
+#include "tools/EventView.hpp"
+#include "tools/Span.hpp"
+#include "tools/StateTraits.hpp"
+#include "tools/TypeIndex.hpp"
 
 namespace fsm {
 
-template <class... States>
-class StateMachine {
+struct snapshot_access;
+
+template <class Policy, class... States>
+using storage_t = typename Policy::Storage::template storage<States...>;
+
+template <class Policy, class... States>
+class BasicStateMachine : protected storage_t<Policy, States...>,
+                          public Policy::EventQueue::queue,
+                          public Policy::Destructor,
+                          protected Policy::Concurrency::publisher {
+    using Storage = storage_t<Policy, States...>;
+
 public:
-    StateMachine() : currentState(&std::get<0>(states)) {
+    using observer_type = typename Policy::Observer;
+
+    /**
+     * @brief Compile-time id of State, its position in States.
+     */
+    template <typename State>
+    static constexpr std::size_t state_id = type_index_v<State, States...>;
+
+    BasicStateMachine() = default;
+
+    constexpr BasicStateMachine(States... states_in) : Storage(std::move(states_in)...) {
+    }
+
+    BasicStateMachine(const BasicStateMachine&) = default;
+    BasicStateMachine(BasicStateMachine&&) = default;
+    BasicStateMachine& operator=(const BasicStateMachine&) = default;
+    BasicStateMachine& operator=(BasicStateMachine&&) = default;
+
+    template <typename State>
+    constexpr State& transitionTo() noexcept(noexcept(std::declval<Storage&>().template select<State>())) {
+        if constexpr (Policy::Concurrency::publishes_state) {
+            return publishing([this]() -> State& {
+                State& entered = this->template select<State>();
+                this->publish(state_id<State>);
+                return entered;
+            });
+        } else {
+            return this->template select<State>();
+        }
+    }
+
+    /**
+     * @brief Index of the current state; wait-free from any thread when the concurrency policy
+     * publishes the state.
+     */
+    constexpr std::size_t currentIndex() const noexcept {
+        if constexpr (Policy::Concurrency::publishes_state) {
+            return this->publishedIndex();
+        } else {
+            return this->index();
+        }
+    }
+
+    /**
+     * @brief Call reader with a consistent copy of State when the machine is in State, from
+     * any thread, retrying while the copy may have been torn by the driver thread.
+     * @details Needs a concurrency policy publishing the state (SeqlockReads), a storage keeping
+     * every state, and a trivially copyable State.
+     * @return false when the machine is not in State; reader is then not called.
+     */
+    template <typename State, typename Reader>
+    bool tryReadState(Reader&& reader) const {
+        static_assert(Policy::Concurrency::publishes_state, "reading from other threads needs SeqlockReads");
+        static_assert(Policy::Storage::keeps_all_states, "the current state of this storage may be destroyed");
+        static_assert(std::is_trivially_copyable_v<State>, "states read from other threads are copied");
+        alignas(State) unsigned char copy[sizeof(State)];
+        const bool inState = this->read([this, &copy] {
+            if (this->publishedIndex() != state_id<State>) {
+                return false;
+            }
+            using std::get;
+            std::memcpy(copy, &get<State>(this->states), sizeof(State));
+            return true;
+        });
+        if (inState) {
+            reader(*std::launder(reinterpret_cast<const State*>(copy)));
+        }
+        return inState;
+    }
+
+    /**
+     * @brief State of type State; with a storage keeping only the current state (InPlaceStorage,
+     * ArenaStorage), State has to be the current one.
+     */
+    template <typename State>
+    constexpr State& state() noexcept {
+        using std::get;
+        return get<State>(this->states);
+    }
+
+    template <typename State>
+    constexpr const State& state() const noexcept {
+        using std::get;
+        return get<State>(this->states);
     }
 
-    virtual ~StateMachine() noexcept {
+    /**
+     * @brief Whether some state reacts to Event; handling an Event no state reacts to compiles
+     * to nothing (unless the policy observes unhandled events).
+     */
+    template <typename Event>
+    static constexpr bool reacts_to() {
+        return (handles_v<States, Event> || ...);
     }
 
-    StateMachine(States... states_in) : states(std::move(states_in)...) {
-        currentState = &std::get<0>(states);
+    /**
+     * @brief Whether the current state reacts to Event.
+     */
+    template <typename Event>
+    constexpr bool wouldReact() const noexcept {
+        constexpr bool reacting[] = {handles_v<States, Event>...};
+        return reacting[this->index()];
     }
 
-    StateMachine(const StateMachine& other) : states(other.states) {
-        currentState = runtime_get(states, other.currentState.index());
+    /**
+     * @brief Handle event in the current state.
+     * @details Goes through event_dispatcher, unless the policy has a NonVirtualDestructor: the
+     * dispatch is then inline and can be evaluated at compile time.
+     */
+    template <typename Event>
+    constexpr void handle(const Event& event) {
+        asExternal(event, [this, &event] {
+            if constexpr (Policy::EventQueue::run_to_completion) {
+                handleToCompletion(event);
+            } else if constexpr (!Policy::Destructor::is_virtual) {
+                handleBy(event, *this);
+            } else {
+                event_dispatcher<BasicStateMachine, Event>::dispatch(*this, event);
+            }
+        });
     }
 
-    StateMachine(StateMachine&& other) : states(std::move(other.states)) {
-        currentState = runtime_get(states, other.currentState.index());
+    template <typename Event, typename Machine>
+    constexpr void handleBy(const Event& event, Machine& machine) {
+        if constexpr (!reacts_to<Event>() && !is_observed_v<Machine>) {
+            return;
+        } else if constexpr (Policy::Concurrency::publishes_state) {
+            publishing([this, &event, &machine] { dispatchWith<typename Policy::Dispatch>(event, machine); });
+        } else {
+            dispatchWith<typename Policy::Dispatch>(event, machine);
+        }
     }
 
-    StateMachine& operator=(const StateMachine& other) {
-        if (this != &other) {
-            states = other.states;
-            currentState = runtime_get(states, other.currentState.index());
+    /**
+     * @brief Handle the alternative held by event with one lookup in an [event][state] table of
+     * handlers, instead of visiting the variant and then the current state.
+     * @details event must not be valueless. With a run-to-completion policy the alternative goes
+     * through handle().
+     */
+    template <typename... Events>
+    constexpr void handleVariant(const std::variant<Events...>& event) {
+        using table = event_state_table<std::variant<Events...>, Events...>;
+        if constexpr (Policy::Concurrency::publishes_state) {
+            publishing([this, &event] { table::lookup_table[event.index()][dispatchIndex()](*this, event); });
+        } else {
+            table::lookup_table[event.index()][dispatchIndex()](*this, event);
         }
-        return *this;
     }
 
-    StateMachine& operator=(StateMachine&& other) {
-        if (this != &other) {
-            states = std::move(other.states);
-            currentState = runtime_get(states, other.currentState.index());
+    /**
+     * @brief Handle the event of type Events[tag] whose object representation starts at payload,
+     * e.g. a message decoded from the wire, without building a variant first.
+     * @details The event is copied out of payload, which needs no alignment, so Events have to be
+     * trivially copyable and default constructible. The handler is looked up as in
+     * handleVariant().
+     * @return false, leaving the machine untouched, when tag is out of Events.
+     */
+    template <typename... Events>
+    bool handleTagged(std::size_t tag, const void* payload) {
+        static_assert(((std::is_trivially_copyable_v<Events> && std::is_default_constructible_v<Events>) && ...),
+                      "tagged events are copied from their bytes");
+        if (tag >= sizeof...(Events)) {
+            return false;
         }
-        return *this;
+        const write_section section{*this};
+        event_state_table<const void*, Events...>::lookup_table[tag][dispatchIndex()](*this, payload);
+        return true;
     }
 
-    template <typename State>
-    State& transitionTo() {
-        State& state = std::get<State>(states);
-        currentState = &state;
-        return state;
+    /**
+     * @brief Handle a received frame as the event of type Events[tag].
+     * @details Events that are views (see EventView) are built over frame, so the frame is not
+     * copied; the others are copied from its first bytes, as with a payload pointer.
+     * @return false, leaving the machine untouched, when tag is out of Events or the frame is
+     * shorter than min_frame_size_v of the event (its size, or the min_size of a view).
+     */
+    template <typename... Events>
+    bool handleTagged(std::size_t tag, span<const std::byte> frame) {
+        static_assert(((is_event_view_v<Events> ||
+                        (std::is_trivially_copyable_v<Events> && std::is_default_constructible_v<Events>)) &&
+                       ...),
+                      "tagged events are views or copied from their bytes");
+        constexpr std::size_t minSizes[] = {min_frame_size_v<Events>..., 0};
+        if (tag >= sizeof...(Events) || frame.size() < minSizes[tag]) {
+            return false;
+        }
+        const write_section section{*this};
+        event_state_table<span<const std::byte>, Events...>::lookup_table[tag][dispatchIndex()](*this, frame);
+        return true;
     }
 
+    /**
+     * @brief Handle a contiguous batch of events, in order.
+     * @details Events are either all of one type or std::variant<Events...>. The current state
+     * is looked up once for every run of events that keeps the machine in the same state.
+     * With a run-to-completion policy every event goes through handle() instead, so that posted
+     * events run between the events of the batch; handleBatchBy bypasses the queue.
+     */
     template <typename Event>
-    void handle(const Event& event) {
-        handleBy(event, *this);
+    void handleBatch(span<Event> events) {
+        if constexpr (Policy::EventQueue::run_to_completion) {
+            // Posted events have to run between the events of the batch.
+            for (const auto& event : events) {
+                handleOne(event);
+            }
+        } else {
+            handleBatchBy(events, *this);
+        }
     }
 
     template <typename Event, typename Machine>
-    void handleBy(const Event& event, Machine& machine) {
-        auto passEventToState = [&machine, &event](auto statePtr) {
-            auto action = statePtr->handle(event);
-            action.execute(machine, *statePtr, event);
-        };
-        std::visit(passEventToState, currentState);
+    void handleBatchBy(span<Event> events, Machine& machine) {
+        using event_type = std::remove_const_t<Event>;
+        const event_type* first = events.data();
+        const event_type* last = first + events.size();
+        if constexpr (!is_variant<event_type>::value && !is_observed_v<Machine>) {
+            if constexpr (!reacts_to<event_type>()) {
+                return;
+            }
+        }
+        auto& table = batch_dispatch_table<Machine, event_type>::lookup_table;
+        const write_section section{*this};
+        while (first != last) {
+            first = table[this->index()](*this, machine, first, last);
+        }
+    }
+
+private:
+    friend struct snapshot_access;
+
+    /**
+     * @brief Section writing to the states, seen by readers on other threads when the
+     * concurrency policy publishes the state.
+     */
+    class write_section {
+    public:
+        explicit write_section(BasicStateMachine& machine) noexcept : machine(machine) {
+            if constexpr (Policy::Concurrency::publishes_state) {
+                machine.beginWrite();
+            }
+        }
+
+        write_section(const write_section&) = delete;
+        write_section& operator=(const write_section&) = delete;
+
+        ~write_section() {
+            if constexpr (Policy::Concurrency::publishes_state) {
+                machine.endWrite();
+            }
+        }
+
+    private:
+        BasicStateMachine& machine;
+    };
+
+    /**
+     * @brief Run handling for an event passed from outside, within the handle_scope of an
+     * observer bracketing such events (see Recorder).
+     */
+    template <typename Event, typename Handling>
+    static constexpr void asExternal(const Event& event, Handling&& handling) {
+        if constexpr (observes_handling_v<BasicStateMachine, Event>) {
+            const handle_scope<BasicStateMachine, Event> scope{event};
+            handling();
+        } else {
+            (void)event;
+            handling();
+        }
+    }
+
+    template <typename Write>
+    decltype(auto) publishing(Write&& write) {
+        const write_section section{*this};
+        return write();
+    }
+
+    template <typename Event>
+    struct is_variant : std::false_type {
+    };
+
+    template <typename... Events>
+    struct is_variant<std::variant<Events...>> : std::true_type {
+    };
+
+    template <typename Event>
+    void handleOne(const Event& event) {
+        if constexpr (is_variant<Event>::value) {
+            std::visit([this](const auto& alternative) { handle(alternative); }, event);
+        } else {
+            handle(event);
+        }
+    }
+
+    /**
+     * @brief Handle event, then the events posted meanwhile; when already running, queue it.
+     * @details An event that does not fit in the queue (or cannot be posted) while running is
+     * handled right away, as without run-to-completion.
+     */
+    template <typename Event>
+    void handleToCompletion(const Event& event) {
+        using queue = typename Policy::EventQueue::queue;
+        if (this->running) {
+            if constexpr (queue::template accepts_v<Event>) {
+                if (this->post(event)) {
+                    return;
+                }
+            }
+            event_dispatcher<BasicStateMachine, Event>::dispatch(*this, event);
+            return;
+        }
+        struct running_guard {
+            bool& running;
+            ~running_guard() {
+                running = false;
+            }
+        } guard{this->running};
+        this->running = true;
+        event_dispatcher<BasicStateMachine, Event>::dispatch(*this, event);
+        this->drainWith([this](const auto& queued) {
+            event_dispatcher<BasicStateMachine, std::decay_t<decltype(queued)>>::dispatch(*this, queued);
+        });
+    }
+
+    /**
+     * @brief Column of the event_state_table to use; with run-to-completion every column is
+     * handle(), so the first one is.
+     */
+    constexpr std::size_t dispatchIndex() const noexcept {
+        if constexpr (Policy::EventQueue::run_to_completion) {
+            return 0;
+        } else {
+            return this->index();
+        }
+    }
+
+    template <std::size_t EventInd, typename... Events>
+    static constexpr const auto& decode(const std::variant<Events...>& event) noexcept {
+        return *std::get_if<EventInd>(&event);
+    }
+
+    template <std::size_t EventInd, typename... Events>
+    static auto decode(const void* payload) noexcept {
+        std::tuple_element_t<EventInd, std::tuple<Events...>> event;
+        std::memcpy(&event, payload, sizeof(event));
+        return event;
+    }
+
+    template <std::size_t EventInd, typename... Events>
+    static auto decode(span<const std::byte> frame) noexcept {
+        using Event = std::tuple_element_t<EventInd, std::tuple<Events...>>;
+        if constexpr (is_event_view_v<Event>) {
+            return Event{frame};
+        } else {
+            return decode<EventInd, Events...>(static_cast<const void*>(frame.data()));
+        }
+    }
+
+    /**
+     * @brief Handlers of every (event, state) pair, the event read from a Source holding one of
+     * Events; pairs where the state does not react share an empty entry.
+     */
+    template <typename Source, typename... Events>
+    struct event_state_table {
+        template <std::size_t EventInd, std::size_t StateInd>
+        static constexpr void dispatchToState(BasicStateMachine& self, const Source& source) {
+            using std::get;
+            const auto& event = decode<EventInd, Events...>(source);
+            if constexpr (Policy::EventQueue::run_to_completion) {
+                self.handle(event);
+            } else {
+                asExternal(event, [&self, &event] { handleInState(get<StateInd>(self.states), self, event); });
+            }
+        }
+
+        static constexpr void ignore(BasicStateMachine&, const Source&) noexcept {
+        }
+
+        using dispatch_fun_ptr = void (*)(BasicStateMachine&, const Source&);
+
+        template <std::size_t EventInd, std::size_t StateInd>
+        static constexpr dispatch_fun_ptr entry() {
+            using Event = std::tuple_element_t<EventInd, std::tuple<Events...>>;
+            using State = std::tuple_element_t<StateInd, std::tuple<States...>>;
+            if constexpr (handles_v<State, Event> || is_observed_v<BasicStateMachine> ||
+                          Policy::EventQueue::run_to_completion) {
+                return &dispatchToState<EventInd, StateInd>;
+            } else {
+                return &ignore;
+            }
+        }
+
+        using row_type = std::array<dispatch_fun_ptr, sizeof...(States)>;
+
+        template <std::size_t EventInd, std::size_t... StateIdxs>
+        static constexpr row_type makeRow(std::index_sequence<StateIdxs...>) {
+            return {{entry<EventInd, StateIdxs>()...}};
+        }
+
+        template <std::size_t... EventIdxs>
+        static constexpr std::array<row_type, sizeof...(Events)> makeTable(std::index_sequence<EventIdxs...>) {
+            return {{makeRow<EventIdxs>(std::index_sequence_for<States...>{})...}};
+        }
+
+        constexpr static std::array<row_type, sizeof...(Events)> lookup_table =
+            makeTable(std::index_sequence_for<Events...>{});
+    };
+
+    template <class Dispatch, typename Event, typename Machine>
+    constexpr void dispatchWith(const Event& event, Machine& machine) {
+        if constexpr (std::is_same_v<Dispatch, TableDispatch>) {
+            runtime_dispatch(this->states, this->index(), machine, event);
+        } else if constexpr (is_hot_path_dispatch<Dispatch>::value) {
+            if (!dispatchHot(event, machine, static_cast<Dispatch*>(nullptr))) {
+                dispatchWith<typename Dispatch::fallback>(event, machine);
+            }
+        } else {
+            auto passEventToState = [&machine, &event](auto statePtr) {
+                notify_dispatch<Machine, std::remove_pointer_t<decltype(statePtr)>, Event>(event);
+                auto action = statePtr->handle(event);
+                action.execute(machine, *statePtr, event);
+            };
+            this->visit(passEventToState);
+        }
+    }
+
+    /**
+     * @brief Handle event inline when the machine is in the state of a Hot pair of Event.
+     * @return false when no pair matched.
+     */
+    template <typename Event, typename Machine, class Fallback, class... HotPairs>
+    constexpr bool dispatchHot(const Event& event, Machine& machine, HotPathDispatch<Fallback, HotPairs...>*) {
+        return (dispatchIfIn<typename HotPairs::state_type>(event, machine,
+                                                            std::is_same<typename HotPairs::event_type, Event>{}) ||
+                ...);
     }
 
-protected:
-    std::tuple<States...> states;
-    std::variant<States*...> currentState;
+    template <typename State, typename Event, typename Machine>
+    constexpr bool dispatchIfIn(const Event& event, Machine& machine, std::true_type) {
+        static_assert(state_id<State> < sizeof...(States), "hot state not in the machine");
+        if (expect_hot(this->index() == state_id<State>)) FSM_LIKELY {
+            using std::get;
+            handleInState(get<State>(this->states), machine, event);
+            return true;
+        }
+        return false;
+    }
+
+    template <typename State, typename Event, typename Machine>
+    static constexpr bool dispatchIfIn(const Event&, Machine&, std::false_type) noexcept {
+        return false;
+    }
+
+    template <typename State, typename Machine, typename Event>
+    static constexpr void handleInState(State& state, Machine& machine, const Event& event) {
+        if constexpr (is_variant<Event>::value) {
+            std::visit([&state, &machine](const auto& alternative) { handleInState(state, machine, alternative); },
+                       event);
+        } else {
+            notify_dispatch<Machine, State, Event>(event);
+            auto action = state.handle(event);
+            action.execute(machine, state, event);
+        }
+    }
+
+    template <typename Machine, typename Event, typename = std::index_sequence_for<States...>>
+    struct batch_dispatch_table;
+
+    template <typename Machine, typename Event, std::size_t... Idxs>
+    struct batch_dispatch_table<Machine, Event, std::index_sequence<Idxs...>> {
+        template <std::size_t Ind>
+        static const Event* runInState(BasicStateMachine& self, Machine& machine, const Event* first,
+                                       const Event* last) {
+            using std::get;
+            using State = std::tuple_element_t<Ind, std::tuple<States...>>;
+            if constexpr (!is_variant<Event>::value && !is_observed_v<Machine>) {
+                if constexpr (!handles_v<State, Event>) {
+                    // Nothing leaves the machine in this state for the rest of the batch.
+                    return last;
+                }
+            }
+            do {
+                // Storages keeping only the current state rebuild it on every transition,
+                // self-transitions included: the state is looked up again for every event.
+                State& state = get<Ind>(self.states);
+                asExternal(*first, [&state, &machine, first] { handleInState(state, machine, *first); });
+                ++first;
+            } while (first != last && self.index() == Ind);
+            return first;
+        }
+
+        using run_fun_ptr = const Event* (*)(BasicStateMachine&, Machine&, const Event*, const Event*);
+
+        constexpr static std::array<run_fun_ptr, sizeof...(Idxs)> lookup_table = {{&runInState<Idxs>...}};
+    };
 };
 
+template <class... States>
+using StateMachine = BasicStateMachine<DefaultPolicy, States...>;
+
 }  // End of namespace fsm
@@ -0,0 +1,44 @@
+#pragma once
+
+#include <chrono>
+#include <cstdint>
+#include <ratio>
+
+namespace fsm {
+
+/**
+ * @brief Event handled by a machine which stayed in a state with an After handler for its whole
+ * timeout.
+ */
+struct Timeout {
+};
+
+/**
+ * @brief Handler running Action on Timeout, when the machine stays in the state for one period
+ * of Duration.
+ * @details Only MachinePool drives the timeout: entering the state through transitionTo arms the
+ * timer of the machine, leaving it cancels the timer, and MachinePool::tick delivers Timeout to
+ * the machines whose timer expired, or passes their ids to a sink, e.g. one posting Timeout to a
+ * ShardedExecutor. A state holds at most one After handler.
+ * @code
+ * struct OpenState : Will<ByDefault<Nothing>, After<timeout_seconds<30>, TransitionTo<ClosedState>>> {};
+ * @endcode
+ * @tparam Duration : std::chrono::duration type, e.g. std::chrono::seconds or timeout_seconds<30>.
+ * @tparam Action : action executed on Timeout.
+ */
+template <typename Duration, typename Action>
+struct After {
+    using timeout_duration = Duration;
+
+    constexpr Action handle(const Timeout&) const {
+        return {};
+    }
+};
+
+template <std::intmax_t Count>
+using timeout_seconds = std::chrono::duration<std::int64_t, std::ratio<Count>>;
+
+template <std::intmax_t Count>
+using timeout_milliseconds = std::chrono::duration<std::int64_t, std::ratio<Count, 1000>>;
+
+}  // End of namespace fsm
@@ -5,7 +5,7 @@ namespace fsm {
 template <typename Action>
 struct ByDefault {
     template <typename Event>
-    Action handle(const Event&) const {
+    constexpr Action handle(const Event&) const {
         return Action{};
     }
 };
@@ -0,0 +1,70 @@
+#pragma once
+
+#include <type_traits>
+#include <utility>
+
+#include "Nothing.hpp"
+
+namespace fsm {
+
+/**
+ * @brief Action executing Then when Guard holds for the state and the event, Else otherwise.
+ * @details Guard is a compile-time pointer to either a const member function of the state,
+ * taking the event or nothing, or a free function taking the state and the event. The guard is
+ * called directly and both actions are default constructed in place, so the choice compiles to
+ * a single branch, where Maybe or OneOf first store the chosen action and then dispatch on it.
+ * If counts as a reaction of the state even when Else is Nothing, like Maybe.
+ * @code
+ * class LockedState : public ByDefault<Nothing> {
+ * public:
+ *     bool matches(const UnlockEvent& e) const { return e.key == key; }
+ *     If<&LockedState::matches, TransitionTo<ClosedState>> handle(const UnlockEvent&) const { return {}; }
+ *     ...
+ * };
+ * @endcode
+ * @tparam Guard : predicate on the state and the event.
+ * @tparam Then : action executed when Guard returns true.
+ * @tparam Else : action executed when Guard returns false.
+ */
+template <auto Guard, typename Then, typename Else = Nothing>
+struct If {
+    static_assert(std::is_default_constructible_v<Then> && std::is_default_constructible_v<Else>,
+                  "If needs default constructible actions");
+
+    template <typename Machine, typename State, typename Event>
+    constexpr void execute(Machine& machine, State& state, const Event& event) noexcept(
+        noexcept(test(std::as_const(state), event)) && noexcept(Then{}.execute(machine, state, event)) &&
+        noexcept(Else{}.execute(machine, state, event))) {
+        if (test(std::as_const(state), event)) {
+            Then{}.execute(machine, state, event);
+        } else {
+            Else{}.execute(machine, state, event);
+        }
+    }
+
+private:
+    template <typename State, typename Event>
+    static constexpr bool test(const State& state, const Event& event) noexcept(noexcept(call(state, event, 0))) {
+        return static_cast<bool>(call(state, event, 0));
+    }
+
+    template <typename State, typename Event>
+    static constexpr auto call(const State& state, const Event& event, int) noexcept(noexcept((state.*Guard)(event)))
+        -> decltype((state.*Guard)(event)) {
+        return (state.*Guard)(event);
+    }
+
+    template <typename State, typename Event>
+    static constexpr auto call(const State& state, const Event&, long) noexcept(noexcept((state.*Guard)()))
+        -> decltype((state.*Guard)()) {
+        return (state.*Guard)();
+    }
+
+    template <typename State, typename Event>
+    static constexpr auto call(const State& state, const Event& event, ...) noexcept(noexcept(Guard(state, event)))
+        -> decltype(Guard(state, event)) {
+        return Guard(state, event);
+    }
+};
+
+}  // End of namespace fsm
@@ -1,10 +1,13 @@
 #pragma once
 
+#include "../policies/Observer.hpp"
+
 namespace fsm {
 
 struct Nothing {
     template <typename Machine, typename State, typename Event>
-    void execute(Machine&, State&, const Event&) {
+    constexpr void execute(Machine&, State&, const Event&) noexcept {
+        notify_unhandled<Machine, State, Event>();
     }
 };
 
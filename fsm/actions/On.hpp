@@ -4,7 +4,7 @@ namespace fsm {
 
 template <typename Event, typename Action>
 struct On {
-    Action handle(const Event&) const {
+    constexpr Action handle(const Event&) const {
         return {};
     }
 };
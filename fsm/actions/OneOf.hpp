@@ -1,19 +1,27 @@
 #pragma once
 
+#include <array>
+#include <cstdint>
+#include <type_traits>
 #include <variant>
 #include <utility>
 
+#include "../tools/TypeIndex.hpp"
+
 namespace fsm {
 
+/**
+ * @brief OneOf storage for arbitrary actions, kept in a std::variant.
+ */
 template <typename... Actions>
-class OneOf {
+class VariantOneOf {
 public:
     template <typename T>
-    OneOf(T&& arg) : options(std::forward<T>(arg)) {
+    constexpr VariantOneOf(T&& arg) : options(std::forward<T>(arg)) {
     }
 
     template <typename Machine, typename State, typename Event>
-    void execute(Machine& machine, State& state, const Event& event) {
+    constexpr void execute(Machine& machine, State& state, const Event& event) {
         std::visit([&machine, &state, &event](auto& action) { action.execute(machine, state, event); }, options);
     }
 
@@ -21,4 +29,57 @@ private:
     std::variant<Actions...> options;
 };
 
+/**
+ * @brief OneOf storage for empty actions, kept as a one-byte tag.
+ * @details The chosen action is default constructed at execution time, through a
+ * compile-time table indexed by the tag. The object is trivially copyable and trivially
+ * destructible, and execute is noexcept whenever every alternative's execute is.
+ */
+template <typename... Actions>
+class TaggedOneOf {
+public:
+    template <typename T>
+    constexpr TaggedOneOf(T&&) noexcept : tag(static_cast<std::uint8_t>(type_index_v<std::decay_t<T>, Actions...>)) {
+        static_assert(type_index_v<std::decay_t<T>, Actions...> < sizeof...(Actions), "T is not one of the actions");
+    }
+
+    template <typename Machine, typename State, typename Event>
+    constexpr void execute(Machine& machine, State& state, const Event& event) noexcept(
+        (noexcept(std::declval<Actions&>().execute(machine, state, event)) && ...)) {
+        action_table<Machine, State, Event>::lookup_table[tag](machine, state, event);
+    }
+
+private:
+    template <typename Machine, typename State, typename Event>
+    struct action_table {
+        template <typename Action>
+        static constexpr void executeAction(Machine& machine, State& state, const Event& event) {
+            Action action{};
+            action.execute(machine, state, event);
+        }
+
+        using execute_fun_ptr = void (*)(Machine&, State&, const Event&);
+
+        constexpr static std::array<execute_fun_ptr, sizeof...(Actions)> lookup_table = {
+            {&executeAction<Actions>...}};
+    };
+
+    std::uint8_t tag;
+};
+
+template <typename... Actions>
+constexpr bool is_compact_one_of_v = (std::is_empty_v<Actions> && ...) && sizeof...(Actions) <= 256;
+
+template <typename... Actions>
+class OneOf
+    : public std::conditional_t<is_compact_one_of_v<Actions...>, TaggedOneOf<Actions...>, VariantOneOf<Actions...>> {
+    using Options =
+        std::conditional_t<is_compact_one_of_v<Actions...>, TaggedOneOf<Actions...>, VariantOneOf<Actions...>>;
+
+public:
+    template <typename T>
+    constexpr OneOf(T&& arg) noexcept(std::is_nothrow_constructible_v<Options, T&&>) : Options(std::forward<T>(arg)) {
+    }
+};
+
 }  // End of namespace fsm
@@ -1,33 +1,113 @@
 #pragma once
 
+#include <cstdint>
+#include <type_traits>
+#include <utility>
+
+#include "../policies/EventQueue.hpp"
+#include "../policies/Observer.hpp"
+#include "../tools/StateTraits.hpp"
+
 namespace fsm {
 
 template <typename TargetState>
 class TransitionTo {
 public:
     template <typename Machine, typename State, typename Event>
-    void execute(Machine& machine, State& prevState, const Event& event) {
-        leave(prevState, event);
-        TargetState& newState = machine.template transitionTo<TargetState>();
-        enter(newState, event);
+    constexpr void execute(Machine& machine, State& prevState, const Event& event) noexcept(
+        noexcept(leave(machine, prevState, event, 0)) && noexcept(machine.template transitionTo<TargetState>()) &&
+        noexcept(enterTarget(machine, std::declval<TargetState&>(), event))) {
+        if constexpr (observer_of_t<Machine>::measures_cycles) {
+            constexpr bool posting = can_post_v<Machine>;
+            constexpr bool timeLeave = has_on_leave_v<State, Event> ||
+                                       (posting && has_posting_on_leave_v<State, Event, event_poster<Machine>>);
+            constexpr bool timeEnter = has_on_enter_v<TargetState, Event> ||
+                                       (posting && has_posting_on_enter_v<TargetState, Event, event_poster<Machine>>);
+            const auto leaveCycles = timed<timeLeave>([&] { leave(machine, prevState, event, 0); });
+            TargetState& newState = machine.template transitionTo<TargetState>();
+            const auto enterCycles = timed<timeEnter>([&] { enterTarget(machine, newState, event); });
+            notify_transition<Machine, State, TargetState, Event>(leaveCycles, enterCycles);
+        } else {
+            leave(machine, prevState, event, 0);
+            TargetState& newState = machine.template transitionTo<TargetState>();
+            enterTarget(machine, newState, event);
+            notify_transition<Machine, State, TargetState, Event>(0, 0);
+        }
     }
 
 private:
-    void leave(...) {
+    /**
+     * @brief Run the onEnter hook of the target; a hook returning a coroutine (see fsm::Task)
+     * hands it over to the machine, which suspends until it completes.
+     */
+    template <typename Machine, typename Event>
+    constexpr void enterTarget(Machine& machine, TargetState& state, const Event& event) noexcept(
+        noexcept(enter(machine, state, event, 0))) {
+        using result = decltype(enter(machine, state, event, 0));
+        if constexpr (suspends_machine_v<result>) {
+            static_assert(has_suspend_on_v<Machine, result>, "onEnter returning a fsm::Task needs an fsm::AsyncMachine");
+            machine.suspendOn(enter(machine, state, event, 0));
+        } else {
+            enter(machine, state, event, 0);
+        }
+    }
+
+    /**
+     * @brief Cycles taken by hook, or 0 without reading the counter when the hook is absent.
+     */
+    template <bool HasHook, typename Hook>
+    static std::uint64_t timed(Hook&& hook) noexcept(noexcept(hook())) {
+        if constexpr (HasHook) {
+            const auto start = cycle_count();
+            hook();
+            return cycle_count() - start;
+        } else {
+            hook();
+            return 0;
+        }
+    }
+
+    constexpr void leave(...) noexcept {
     }
 
     template <typename State, typename Event>
-    auto leave(State& state, const Event& event) -> decltype(state.onLeave(event)) {
+    constexpr auto leave(State& state, const Event& event) -> decltype(state.onLeave(event)) {
         return state.onLeave(event);
     }
 
-    void enter(...) {
+    template <typename Machine, typename State, typename Event, typename = std::enable_if_t<can_post_v<Machine>>>
+    constexpr auto leave(Machine& machine, State& state, const Event& event, int)
+        -> decltype(state.onLeave(event, std::declval<event_poster<Machine>&>())) {
+        event_poster<Machine> poster{machine};
+        return state.onLeave(event, poster);
+    }
+
+    template <typename Machine, typename State, typename Event>
+    constexpr auto leave(Machine&, State& state, const Event& event, long) noexcept(noexcept(leave(state, event)))
+        -> decltype(leave(state, event)) {
+        return leave(state, event);
+    }
+
+    constexpr void enter(...) noexcept {
     }
 
     template <typename State, typename Event>
-    auto enter(State& state, const Event& event) -> decltype(state.onEnter(event)) {
+    constexpr auto enter(State& state, const Event& event) -> decltype(state.onEnter(event)) {
         return state.onEnter(event);
     }
+
+    template <typename Machine, typename State, typename Event, typename = std::enable_if_t<can_post_v<Machine>>>
+    constexpr auto enter(Machine& machine, State& state, const Event& event, int)
+        -> decltype(state.onEnter(event, std::declval<event_poster<Machine>&>())) {
+        event_poster<Machine> poster{machine};
+        return state.onEnter(event, poster);
+    }
+
+    template <typename Machine, typename State, typename Event>
+    constexpr auto enter(Machine&, State& state, const Event& event, long) noexcept(noexcept(enter(state, event)))
+        -> decltype(enter(state, event)) {
+        return enter(state, event);
+    }
 };
 
 }  // End of namespace fsm
@@ -1,10 +1,10 @@
 #pragma once
 
-namespace {
+namespace fsm {
 
 template <typename... Handlers>
 struct Will : Handlers... {
     using Handlers::handle...;
 };
 
-}  // namespace
+}  // End of namespace fsm
@@ -0,0 +1,204 @@
+#pragma once
+
+#include <algorithm>
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <vector>
+
+#include "../policies/Observer.hpp"
+#include "../tools/TypeIndex.hpp"
+
+namespace fsm {
+
+/**
+ * @brief Observer counting dispatches, unhandled events and transitions per calling thread.
+ * @details Every thread updates its own Counters with plain increments, so the hot path takes
+ * no lock, issues no atomic operation and never allocates. Counters are sized from StateCount
+ * and Events; events outside Events share the last event slot. Cycles spent in onLeave/onEnter
+ * go into log2 buckets per source/target state.
+ * A thread is only counted once it called prepare(), which allocates its Counters, the
+ * transition matrix of StateCount² * (sizeof...(Events) + 1) counters included, so that
+ * threads which are not profiled pay nothing; the hooks skip the other threads.
+ * @code
+ * struct ProfiledPolicy : fsm::DefaultPolicy {
+ *     using Observer = fsm::HistogramObserver<3, OpenEvent, CloseEvent, LockEvent, UnlockEvent>;
+ * };
+ * ProfiledPolicy::Observer::prepare();  // On every profiled thread, before it handles events.
+ * @endcode
+ * @tparam StateCount : number of states of the observed machines.
+ * @tparam Events : events given their own slot.
+ */
+template <std::size_t StateCount, typename... Events>
+class HistogramObserver {
+public:
+    using cycles_t = std::uint64_t;
+
+    static constexpr bool measures_cycles = true;
+    static constexpr std::size_t state_count = StateCount;
+    static constexpr std::size_t event_count = sizeof...(Events) + 1;
+    static constexpr std::size_t bucket_count = 64;
+
+    template <typename Event>
+    static constexpr std::size_t event_id = type_index_v<Event, Events...>;
+
+    /**
+     * @brief A (state id, event id) pair and the number of times it was dispatched.
+     */
+    struct hot_pair {
+        std::size_t state;
+        std::size_t event;
+        std::uint64_t count;
+    };
+
+    struct Counters {
+        std::array<std::uint64_t, StateCount * event_count> dispatched;
+        std::array<std::uint64_t, StateCount * event_count> unhandled;
+        /// Transitions, [(from * StateCount + to) * event_count + event].
+        std::vector<std::uint64_t> transitions = std::vector<std::uint64_t>(StateCount * StateCount * event_count);
+        std::array<std::uint64_t, StateCount * bucket_count> leaveCycles;
+        std::array<std::uint64_t, StateCount * bucket_count> enterCycles;
+
+        std::uint64_t dispatchCount(std::size_t state, std::size_t event) const noexcept {
+            return dispatched[state * event_count + event];
+        }
+
+        std::uint64_t unhandledCount(std::size_t state, std::size_t event) const noexcept {
+            return unhandled[state * event_count + event];
+        }
+
+        std::uint64_t transitionCount(std::size_t from, std::size_t to, std::size_t event) const noexcept {
+            return transitions[(from * StateCount + to) * event_count + event];
+        }
+
+        /**
+         * @brief Number of onLeave calls of state that took [2^bucket, 2^(bucket + 1)) cycles,
+         * bucket 0 also holding the zero-cycle (absent hook) calls.
+         */
+        std::uint64_t leaveHistogram(std::size_t state, std::size_t bucket) const noexcept {
+            return leaveCycles[state * bucket_count + bucket];
+        }
+
+        std::uint64_t enterHistogram(std::size_t state, std::size_t bucket) const noexcept {
+            return enterCycles[state * bucket_count + bucket];
+        }
+
+        /**
+         * @brief The most dispatched (state, event) pairs, most frequent first, which together
+         * take at least share of the dispatches; the hot set of a HotPathDispatch.
+         * @details The slot of the events outside Events is left out.
+         */
+        std::vector<hot_pair> hottest(double share = 0.95) const {
+            std::vector<hot_pair> pairs;
+            std::uint64_t total = 0;
+            for (std::size_t state = 0; state < StateCount; ++state) {
+                for (std::size_t event = 0; event + 1 < event_count; ++event) {
+                    const std::uint64_t count = dispatchCount(state, event);
+                    total += count;
+                    if (count > 0) {
+                        pairs.push_back({state, event, count});
+                    }
+                }
+            }
+            std::stable_sort(pairs.begin(), pairs.end(),
+                             [](const hot_pair& a, const hot_pair& b) { return a.count > b.count; });
+            std::uint64_t covered = 0;
+            std::size_t kept = 0;
+            while (kept < pairs.size() && static_cast<double>(covered) < share * static_cast<double>(total)) {
+                covered += pairs[kept++].count;
+            }
+            pairs.resize(kept);
+            return pairs;
+        }
+
+        Counters& operator+=(const Counters& other) noexcept {
+            add(dispatched, other.dispatched);
+            add(unhandled, other.unhandled);
+            for (std::size_t i = 0; i < transitions.size(); ++i) {
+                transitions[i] += other.transitions[i];
+            }
+            add(leaveCycles, other.leaveCycles);
+            add(enterCycles, other.enterCycles);
+            return *this;
+        }
+
+    private:
+        template <std::size_t N>
+        static void add(std::array<std::uint64_t, N>& to, const std::array<std::uint64_t, N>& from) noexcept {
+            for (std::size_t i = 0; i < N; ++i) {
+                to[i] += from[i];
+            }
+        }
+    };
+
+    /**
+     * @brief Allocate the Counters of the calling thread, which is counted from then on.
+     * @details Throws std::bad_alloc; does nothing when the thread is prepared already.
+     */
+    static void prepare() {
+        auto& counters = held();
+        if (!counters) {
+            counters = std::make_unique<Counters>();
+        }
+    }
+
+    /**
+     * @brief Counters of the calling thread, prepared if it was not. Read them from that thread,
+     * e.g. before it exits, and merge with operator+=.
+     */
+    static Counters& local() {
+        prepare();
+        return *held();
+    }
+
+    static void reset() {
+        local() = Counters{};
+    }
+
+    template <std::size_t State, typename Event>
+    static void onDispatch() noexcept {
+        static_assert(State < StateCount, "StateCount is smaller than the machine");
+        if (Counters* counters = held().get()) {
+            ++counters->dispatched[State * event_count + event_id<Event>];
+        }
+    }
+
+    template <std::size_t State, typename Event>
+    static void onUnhandled() noexcept {
+        static_assert(State < StateCount, "StateCount is smaller than the machine");
+        if (Counters* counters = held().get()) {
+            ++counters->unhandled[State * event_count + event_id<Event>];
+        }
+    }
+
+    template <std::size_t From, std::size_t To, typename Event>
+    static void onTransition(cycles_t leaveCycles, cycles_t enterCycles) noexcept {
+        static_assert(From < StateCount && To < StateCount, "StateCount is smaller than the machine");
+        if (Counters* counters = held().get()) {
+            ++counters->transitions[(From * StateCount + To) * event_count + event_id<Event>];
+            ++counters->leaveCycles[From * bucket_count + bucket(leaveCycles)];
+            ++counters->enterCycles[To * bucket_count + bucket(enterCycles)];
+        }
+    }
+
+    static std::size_t bucket(cycles_t cycles) noexcept {
+#if defined(__GNUC__)
+        return cycles == 0 ? 0 : 63 - static_cast<std::size_t>(__builtin_clzll(cycles));
+#else
+        std::size_t log = 0;
+        while (cycles >>= 1) {
+            ++log;
+        }
+        return log;
+#endif
+    }
+
+private:
+    static std::unique_ptr<Counters>& held() noexcept {
+        thread_local std::unique_ptr<Counters> counters;
+        return counters;
+    }
+};
+
+}  // End of namespace fsm
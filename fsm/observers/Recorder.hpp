@@ -0,0 +1,116 @@
+#pragma once
+
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <type_traits>
+#include <variant>
+
+#include "../policies/Observer.hpp"
+#include "../tools/EventLog.hpp"
+#include "../tools/TypeIndex.hpp"
+
+namespace fsm {
+
+/**
+ * @brief Observer appending every event passed to the observed machines from outside to the
+ * EventLog attached by the calling thread, for a Replayer to play back.
+ * @details Only the events given to handle(), handleVariant(), handleTagged() or handleBatch()
+ * by the caller are recorded: the events posted by hooks of a run-to-completion machine, and the
+ * events handled by machines nested in the handling of another one, are produced again by the
+ * replay itself. A record holds a steady_clock timestamp in nanoseconds, the position of the
+ * event in Events and its bytes, hence Events have to be trivially copyable. Events outside
+ * Events, and events handled on a thread without a log, are not recorded. Recording is a
+ * bounded copy into preallocated memory: it never allocates, and drops records once the log is
+ * full.
+ * @code
+ * struct RecordedPolicy : fsm::DefaultPolicy {
+ *     using Observer = fsm::Recorder<OpenEvent, CloseEvent, LockEvent, UnlockEvent>;
+ * };
+ * fsm::EventLog log;
+ * log.create("door.log", 1 << 30);
+ * RecordedPolicy::Observer::attach(&log);
+ * @endcode
+ * @tparam Events : recorded events, in the order a Replayer expects them.
+ */
+template <typename... Events>
+class Recorder {
+    static_assert((std::is_trivially_copyable_v<Events> && ...), "recorded events are copied as bytes");
+
+public:
+    using cycles_t = std::uint64_t;
+
+    static constexpr bool measures_cycles = false;
+
+    /**
+     * @brief Record the events handled by the calling thread into log, or stop recording them
+     * with nullptr.
+     */
+    static void attach(EventLog* log) noexcept {
+        local() = log;
+    }
+
+    static EventLog* attached() noexcept {
+        return local();
+    }
+
+    /**
+     * @brief Record event unless it is handled while the calling thread handles another one.
+     */
+    template <typename Event>
+    static void onHandle(const Event& event) noexcept {
+        if (depth()++ == 0) {
+            record(event);
+        }
+    }
+
+    static void onHandled() noexcept {
+        --depth();
+    }
+
+    template <std::size_t State, typename Event>
+    static void onDispatch() noexcept {
+    }
+
+    template <std::size_t State, typename Event>
+    static void onUnhandled() noexcept {
+    }
+
+    template <std::size_t From, std::size_t To, typename Event>
+    static void onTransition(cycles_t, cycles_t) noexcept {
+    }
+
+private:
+    template <typename Event>
+    static void record(const Event& event) noexcept {
+        constexpr std::size_t type = type_index_v<Event, Events...>;
+        if constexpr (type < sizeof...(Events)) {
+            if (EventLog* log = local()) {
+                const auto now = std::chrono::steady_clock::now().time_since_epoch();
+                log->append(static_cast<std::uint32_t>(type),
+                            static_cast<std::uint64_t>(std::chrono::nanoseconds(now).count()), &event,
+                            static_cast<std::uint32_t>(sizeof(Event)));
+            }
+        }
+    }
+
+    template <typename... Alternatives>
+    static void record(const std::variant<Alternatives...>& event) noexcept {
+        std::visit([](const auto& alternative) { record(alternative); }, event);
+    }
+
+    /**
+     * @brief Number of external events the calling thread is handling, nested ones included.
+     */
+    static std::size_t& depth() noexcept {
+        thread_local std::size_t handling = 0;
+        return handling;
+    }
+
+    static EventLog*& local() noexcept {
+        thread_local EventLog* log = nullptr;
+        return log;
+    }
+};
+
+}  // End of namespace fsm
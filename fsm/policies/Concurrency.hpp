@@ -0,0 +1,108 @@
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+
+namespace fsm {
+
+/**
+ * @brief Concurrency policy used by fsm::DefaultPolicy: the machine is only ever touched by the
+ * thread driving it.
+ */
+struct SingleThreaded {
+    static constexpr bool publishes_state = false;
+
+    struct publisher {
+    };
+};
+
+/**
+ * @brief Concurrency policy letting other threads read the state of a machine while one thread
+ * drives it.
+ * @details The driver publishes the current index in an atomic on every transition, so that
+ * currentIndex() is wait-free from any thread, and bumps a sequence number around everything
+ * that can write to the states (handling events, transitions), so that tryReadState<State>(fn)
+ * can copy a state and retry when the copy may be torn. The driver never waits on readers: it
+ * pays two plain stores per handled event and one per transition. Readers retry while the
+ * driver is inside a handler, hence many times if it handles events back to back.
+ * @code
+ * struct MonitoredPolicy : fsm::DefaultPolicy {
+ *     using Concurrency = fsm::SeqlockReads;
+ * };
+ * // On a monitoring thread:
+ * door.tryReadState<LockedState>([](const LockedState& locked) { report(locked.key); });
+ * @endcode
+ */
+struct SeqlockReads {
+    static constexpr bool publishes_state = true;
+
+    class publisher {
+    public:
+        publisher() noexcept = default;
+
+        publisher(const publisher& other) noexcept : published(other.published.load(std::memory_order_relaxed)) {
+        }
+
+        publisher& operator=(const publisher& other) noexcept {
+            beginWrite();
+            published.store(other.published.load(std::memory_order_relaxed), std::memory_order_release);
+            endWrite();
+            return *this;
+        }
+
+        /**
+         * @brief Index of the current state, from any thread.
+         */
+        std::size_t publishedIndex() const noexcept {
+            return published.load(std::memory_order_acquire);
+        }
+
+        /**
+         * @brief Enter a section writing to the states, on the driver thread; sections nest.
+         */
+        void beginWrite() noexcept {
+            if (depth++ == 0) {
+                sequence.store(sequence.load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+                std::atomic_thread_fence(std::memory_order_release);
+            }
+        }
+
+        void endWrite() noexcept {
+            if (--depth == 0) {
+                sequence.store(sequence.load(std::memory_order_relaxed) + 1, std::memory_order_release);
+            }
+        }
+
+        void publish(std::size_t index) noexcept {
+            published.store(index, std::memory_order_release);
+        }
+
+        /**
+         * @brief Run copy(), which returns whether it copied anything, until it ran outside of a
+         * write section, from any thread.
+         * @return What the last copy() returned.
+         */
+        template <typename Copy>
+        bool read(Copy&& copy) const {
+            for (;;) {
+                const std::uint64_t before = sequence.load(std::memory_order_acquire);
+                if (before & 1) {
+                    continue;
+                }
+                const bool copied = copy();
+                std::atomic_thread_fence(std::memory_order_acquire);
+                if (sequence.load(std::memory_order_relaxed) == before) {
+                    return copied;
+                }
+            }
+        }
+
+    private:
+        std::atomic<std::uint64_t> sequence{0};
+        std::atomic<std::size_t> published{0};
+        unsigned depth = 0;
+    };
+};
+
+}  // End of namespace fsm
@@ -0,0 +1,35 @@
+#pragma once
+
+#include "../storage/ArenaStorage.hpp"
+#include "../storage/InPlaceStorage.hpp"
+#include "../storage/IndexStorage.hpp"
+#include "../storage/PointerStorage.hpp"
+#include "Concurrency.hpp"
+#include "Destructor.hpp"
+#include "Dispatch.hpp"
+#include "EventQueue.hpp"
+#include "Observer.hpp"
+
+namespace fsm {
+
+/**
+ * @brief Policy used by fsm::StateMachine.
+ * @details Derive from it and override single members to select other behaviours, e.g.
+ * @code
+ * struct FastPolicy : fsm::DefaultPolicy {
+ *     using Dispatch = fsm::TableDispatch;
+ *     using Storage = fsm::IndexStorage;
+ * };
+ * using Door = fsm::BasicStateMachine<FastPolicy, ClosedState, OpenState, LockedState>;
+ * @endcode
+ */
+struct DefaultPolicy {
+    using Dispatch = VisitDispatch;
+    using Storage = PointerStorage;
+    using Observer = NoObserver;
+    using EventQueue = NoEventQueue;
+    using Destructor = VirtualDestructor;
+    using Concurrency = SingleThreaded;
+};
+
+}  // End of namespace fsm
@@ -0,0 +1,38 @@
+#pragma once
+
+namespace fsm {
+
+/**
+ * @brief Destructor policy used by fsm::DefaultPolicy: the machine has a virtual destructor and
+ * can be deleted through a pointer to a class deriving from it.
+ */
+struct VirtualDestructor {
+    static constexpr bool is_virtual = true;
+
+    virtual ~VirtualDestructor() noexcept = default;
+};
+
+/**
+ * @brief Destructor policy without vtable pointer.
+ * @details The machine is a literal type whenever its states are, and handle() dispatches inline
+ * rather than through event_dispatcher, so that events can be handled in constant expressions:
+ * @code
+ * struct ConstexprPolicy : fsm::DefaultPolicy {
+ *     using Storage = fsm::IndexStorage;
+ *     using Destructor = fsm::NonVirtualDestructor;
+ * };
+ * constexpr std::size_t afterUnlock() {
+ *     fsm::BasicStateMachine<ConstexprPolicy, LockedState, ClosedState> door;
+ *     door.handle(UnlockEvent{});
+ *     return door.currentIndex();
+ * }
+ * static_assert(afterUnlock() == 1);
+ * @endcode
+ * Such machines ignore FSM_EXTERN_DISPATCH. Before C++20, only IndexStorage can be used in
+ * constant expressions, as assigning the std::variant of PointerStorage is not constexpr.
+ */
+struct NonVirtualDestructor {
+    static constexpr bool is_virtual = false;
+};
+
+}  // End of namespace fsm
@@ -0,0 +1,84 @@
+#pragma once
+
+/**
+ * @brief Statement attribute marking the branch a machine expects to take, [[likely]] in C++20.
+ */
+#if defined(__has_cpp_attribute) && __cplusplus >= 202002L
+#if __has_cpp_attribute(likely)
+#define FSM_LIKELY [[likely]]
+#endif
+#endif
+#ifndef FSM_LIKELY
+#define FSM_LIKELY
+#endif
+
+namespace fsm {
+
+/**
+ * @brief Dispatches events with std::visit over the current state.
+ */
+struct VisitDispatch {
+};
+
+/**
+ * @brief Dispatches events through a compile-time table of handlers indexed by the current
+ * state, one table per event type.
+ * @details Machines of up to inline_dispatch_limit (16) states compare the current index with
+ * the states reacting to the event and run the matching handler inline, as std::visit does; a
+ * table of function pointers measured up to twice slower there. Larger machines make one
+ * indirect call through the table, which keeps the cost flat in the number of states.
+ */
+struct TableDispatch {
+};
+
+/**
+ * @brief A (state, event) pair expected to carry most of the traffic.
+ */
+template <class State, class Event>
+struct Hot {
+    using state_type = State;
+    using event_type = Event;
+};
+
+/**
+ * @brief Checks the current state against the Hot pairs of the event, in the given order,
+ * with inline comparisons hinted as likely, and only dispatches with Fallback when none
+ * matches.
+ * @details The hot set is written by hand, or from the pairs HistogramObserver::Counters
+ * reports with hottest(). Events without a hot pair go straight to Fallback.
+ * @code
+ * struct SkewedPolicy : fsm::DefaultPolicy {
+ *     using Dispatch = fsm::HotPathDispatch<fsm::TableDispatch, fsm::Hot<OpenState, CloseEvent>,
+ *                                           fsm::Hot<ClosedState, OpenEvent>>;
+ * };
+ * @endcode
+ * @tparam Fallback : VisitDispatch or TableDispatch.
+ * @tparam HotPairs : Hot pairs, most frequent first.
+ */
+template <class Fallback, class... HotPairs>
+struct HotPathDispatch {
+    using fallback = Fallback;
+};
+
+template <class Dispatch>
+struct is_hot_path_dispatch {
+    static constexpr bool value = false;
+};
+
+template <class Fallback, class... HotPairs>
+struct is_hot_path_dispatch<HotPathDispatch<Fallback, HotPairs...>> {
+    static constexpr bool value = true;
+};
+
+/**
+ * @brief Condition hint for compilers without [[likely]].
+ */
+constexpr bool expect_hot(bool condition) noexcept {
+#if defined(__GNUC__) && __cplusplus < 202002L
+    return __builtin_expect(condition, 1);
+#else
+    return condition;
+#endif
+}
+
+}  // End of namespace fsm
@@ -0,0 +1,136 @@
+#pragma once
+
+#include <array>
+#include <cstddef>
+#include <type_traits>
+#include <utility>
+#include <variant>
+
+#include "../tools/TypeIndex.hpp"
+
+namespace fsm {
+
+/**
+ * @brief Event queue policy used by fsm::DefaultPolicy: handle() dispatches right away and
+ * actions cannot post events.
+ */
+struct NoEventQueue {
+    static constexpr bool run_to_completion = false;
+
+    struct queue {
+    };
+};
+
+/**
+ * @brief Run-to-completion event queue policy.
+ * @details The machine owns a fixed-capacity ring of std::variant<Events...> stored inline, and
+ * gains post(). Events posted by actions and hooks, and events passed to handle() while the
+ * machine is already handling one, are queued and handled, in order, once the current event
+ * and its transition are complete, by the outermost handle() call. Hooks receive a poster when
+ * they take a second argument:
+ * @code
+ * struct SynReceived : fsm::ByDefault<fsm::Nothing> {
+ *     template <typename Poster>
+ *     void onEnter(const Syn&, Poster& poster) {
+ *         poster.post(SendAck{});
+ *     }
+ * };
+ * @endcode
+ * @tparam Capacity : number of events the queue can hold.
+ * @tparam Events : events that can be posted, the first one default constructible.
+ */
+template <std::size_t Capacity, class... Events>
+struct RunToCompletion {
+    static_assert(Capacity > 0, "the queue needs room for one event");
+
+    static constexpr bool run_to_completion = true;
+
+    class queue {
+    public:
+        using event_type = std::variant<Events...>;
+
+        template <typename Event>
+        static constexpr bool accepts_v = type_index_v<std::decay_t<Event>, Events...> < sizeof...(Events);
+
+        /**
+         * @brief Queue an event to be handled after the current one.
+         * @return false when the queue is full, the event is then dropped.
+         */
+        template <typename Event>
+        bool post(Event&& event) noexcept(std::is_nothrow_constructible_v<event_type, Event&&>) {
+            static_assert(accepts_v<Event>, "event not listed in RunToCompletion");
+            if (count == Capacity) {
+                return false;
+            }
+            std::size_t tail = head + count;
+            if (tail >= Capacity) {
+                tail -= Capacity;
+            }
+            ring[tail] = event_type{std::forward<Event>(event)};
+            ++count;
+            return true;
+        }
+
+        std::size_t pending() const noexcept {
+            return count;
+        }
+
+    protected:
+        /**
+         * @brief Pass queued events to handler until the queue is empty, including the events
+         * handler posts.
+         */
+        template <typename Handler>
+        void drainWith(Handler&& handler) {
+            while (count != 0) {
+                event_type event = std::move(ring[head]);
+                head = head + 1 == Capacity ? 0 : head + 1;
+                --count;
+                std::visit(handler, event);
+            }
+        }
+
+        bool running = false;
+
+    private:
+        std::array<event_type, Capacity> ring{};
+        std::size_t head = 0;
+        std::size_t count = 0;
+    };
+};
+
+/**
+ * @brief Handle given to onEnter/onLeave hooks taking a second argument; it can post events to
+ * the machine and nothing else.
+ */
+template <typename Machine>
+class event_poster {
+public:
+    explicit event_poster(Machine& machine) noexcept : machine(machine) {
+    }
+
+    template <typename Event>
+    bool post(Event&& event) {
+        return machine.post(std::forward<Event>(event));
+    }
+
+private:
+    Machine& machine;
+};
+
+/**
+ * @brief Whether Machine has a run-to-completion queue; hooks taking a poster are only called
+ * on such machines.
+ */
+template <typename Machine, typename = void>
+struct can_post : std::false_type {
+};
+
+template <typename Machine>
+struct can_post<Machine, std::void_t<decltype(std::declval<const Machine&>().pending())>> : std::true_type {
+};
+
+template <typename Machine>
+constexpr bool can_post_v = can_post<Machine>::value;
+
+}  // End of namespace fsm
@@ -0,0 +1,166 @@
+#pragma once
+
+#include <chrono>
+#include <cstdint>
+#include <type_traits>
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <x86intrin.h>
+#endif
+
+namespace fsm {
+
+/**
+ * @brief Observer used by fsm::DefaultPolicy; every hook is empty and compiles away.
+ * @details An observer is a type with static, noexcept hooks. State ids are the positions of
+ * the states in the machine's state list, the event is passed as a type:
+ * @code
+ * template <std::size_t State, typename Event> static void onDispatch() noexcept;
+ * template <std::size_t State, typename Event> static void onDispatch(const Event&) noexcept;
+ * template <std::size_t State, typename Event> static void onUnhandled() noexcept;
+ * template <std::size_t From, std::size_t To, typename Event>
+ * static void onTransition(cycles_t leaveCycles, cycles_t enterCycles) noexcept;
+ * @endcode
+ * An observer defines onDispatch either way, the second one sees the event itself.
+ * onLeave/onEnter are timed with cycle_count() only when measures_cycles is true, otherwise
+ * onTransition receives zeros. An observer may also bracket every event passed to a machine
+ * from outside (handle, handleVariant, handleTagged, handleBatch), events posted while it runs
+ * to completion and inner machines included:
+ * @code
+ * template <typename Event> static void onHandle(const Event&) noexcept;
+ * static void onHandled() noexcept;
+ * @endcode
+ */
+struct NoObserver {
+    using cycles_t = std::uint64_t;
+
+    static constexpr bool measures_cycles = false;
+
+    template <std::size_t State, typename Event>
+    static void onDispatch() noexcept {
+    }
+
+    template <std::size_t State, typename Event>
+    static void onUnhandled() noexcept {
+    }
+
+    template <std::size_t From, std::size_t To, typename Event>
+    static void onTransition(cycles_t, cycles_t) noexcept {
+    }
+};
+
+/**
+ * @brief Cheapest available timestamp: the TSC on x86, the virtual counter on AArch64,
+ * steady_clock nanoseconds elsewhere.
+ */
+inline std::uint64_t cycle_count() noexcept {
+#if defined(__x86_64__) || defined(__i386__)
+    return __rdtsc();
+#elif defined(__aarch64__)
+    std::uint64_t ticks;
+    asm volatile("mrs %0, cntvct_el0" : "=r"(ticks));
+    return ticks;
+#else
+    return static_cast<std::uint64_t>(std::chrono::steady_clock::now().time_since_epoch().count());
+#endif
+}
+
+/**
+ * @brief Observer of Machine: its observer_type, or NoObserver for machines without one.
+ */
+template <typename Machine, typename = void>
+struct observer_of {
+    using type = NoObserver;
+};
+
+template <typename Machine>
+struct observer_of<Machine, std::void_t<typename Machine::observer_type>> {
+    using type = typename Machine::observer_type;
+};
+
+template <typename Machine>
+using observer_of_t = typename observer_of<Machine>::type;
+
+template <typename Machine>
+constexpr bool is_observed_v = !std::is_same_v<observer_of_t<Machine>, NoObserver>;
+
+/**
+ * @brief Whether Observer defines the onDispatch hook taking the event.
+ */
+template <typename Observer, std::size_t State, typename Event, typename = void>
+struct observes_events : std::false_type {
+};
+
+template <typename Observer, std::size_t State, typename Event>
+struct observes_events<Observer, State, Event,
+                       std::void_t<decltype(Observer::template onDispatch<State, Event>(std::declval<const Event&>()))>>
+    : std::true_type {
+};
+
+/**
+ * @brief Whether Observer defines the onHandle/onHandled hooks bracketing external events.
+ */
+template <typename Observer, typename Event, typename = void>
+struct observes_handling : std::false_type {
+};
+
+template <typename Observer, typename Event>
+struct observes_handling<Observer, Event,
+                         std::void_t<decltype(Observer::onHandle(std::declval<const Event&>())),
+                                     decltype(Observer::onHandled())>> : std::true_type {
+};
+
+template <typename Machine, typename Event>
+constexpr bool observes_handling_v = observes_handling<observer_of_t<Machine>, Event>::value;
+
+/**
+ * @brief Scope of an event passed to Machine from outside, calling onHandle on entry and
+ * onHandled on exit, exceptions included; only used when observes_handling_v holds.
+ */
+template <typename Machine, typename Event>
+class handle_scope {
+    using observer = observer_of_t<Machine>;
+
+public:
+    explicit handle_scope(const Event& event) noexcept {
+        observer::onHandle(event);
+    }
+
+    handle_scope(const handle_scope&) = delete;
+    handle_scope& operator=(const handle_scope&) = delete;
+
+    ~handle_scope() {
+        observer::onHandled();
+    }
+};
+
+template <typename Machine, typename State, typename Event>
+constexpr void notify_dispatch(const Event& event) noexcept {
+    if constexpr (is_observed_v<Machine>) {
+        using observer = observer_of_t<Machine>;
+        constexpr std::size_t state = Machine::template state_id<State>;
+        if constexpr (observes_events<observer, state, Event>::value) {
+            observer::template onDispatch<state, Event>(event);
+        } else {
+            observer::template onDispatch<state, Event>();
+        }
+    }
+}
+
+template <typename Machine, typename State, typename Event>
+constexpr void notify_unhandled() noexcept {
+    if constexpr (is_observed_v<Machine>) {
+        observer_of_t<Machine>::template onUnhandled<Machine::template state_id<State>, Event>();
+    }
+}
+
+template <typename Machine, typename From, typename To, typename Event>
+constexpr void notify_transition(std::uint64_t leaveCycles, std::uint64_t enterCycles) noexcept {
+    if constexpr (is_observed_v<Machine>) {
+        observer_of_t<Machine>::template onTransition<Machine::template state_id<From>,
+                                                      Machine::template state_id<To>, Event>(leaveCycles,
+                                                                                             enterCycles);
+    }
+}
+
+}  // End of namespace fsm
@@ -0,0 +1,201 @@
+#pragma once
+
+#include <array>
+#include <cstddef>
+#include <memory>
+#include <tuple>
+#include <type_traits>
+#include <utility>
+
+#include "../tools/StateIndex.hpp"
+#include "../tools/TypeIndex.hpp"
+#include "InPlaceStorage.hpp"
+
+namespace fsm {
+
+/**
+ * @brief Keeps only the current state, in a block of exactly its size drawn from Allocator, so
+ * that a machine holds one pointer and heavy states live in a pool or an arena.
+ * @details Allocator is a default constructible allocator of any value type, rebound to each
+ * state, e.g. std::pmr::polymorphic_allocator<std::byte> over a std::pmr pool resource. Entering
+ * a state, self-transitions included, allocates and default constructs it, then destroys and
+ * deallocates the previous state, hence between its onLeave and the onEnter of the target; if
+ * allocation or construction throws, the machine stays in the previous state. As with
+ * InPlaceStorage, state<State>() is only valid for the current state and a machine cannot be
+ * built from states. A moved-from machine holds no state and can only be assigned to or
+ * destroyed.
+ */
+template <class Allocator, class... States>
+class ArenaStateStorage {
+    using traits = std::allocator_traits<Allocator>;
+
+public:
+    using index_type = state_index_t<sizeof...(States)>;
+    using allocator_type = Allocator;
+
+    ArenaStateStorage() {
+        states.reset(ops::template create<std::tuple_element_t<0, std::tuple<States...>>>(arena));
+    }
+
+    ArenaStateStorage(States... states_in) = delete;
+
+    ArenaStateStorage(const ArenaStateStorage& other)
+        : arena(traits::select_on_container_copy_construction(other.arena)), currentState(other.currentState) {
+        states.reset(ops::copy_table[currentState](arena, other.states.address()));
+    }
+
+    ArenaStateStorage(ArenaStateStorage&& other) noexcept
+        : arena(std::move(other.arena)), currentState(other.currentState) {
+        states.reset(other.states.address());
+        other.states.reset(nullptr);
+    }
+
+    ArenaStateStorage& operator=(const ArenaStateStorage& other) {
+        if (this != &other) {
+            void* copy = ops::copy_table[other.currentState](arena, other.states.address());
+            release();
+            states.reset(copy);
+            currentState = other.currentState;
+        }
+        return *this;
+    }
+
+    /**
+     * @brief Take the state of other when both allocators are equal, otherwise move it into a
+     * block of this allocator.
+     */
+    ArenaStateStorage& operator=(ArenaStateStorage&& other) {
+        if (this != &other) {
+            if (traits::is_always_equal::value || arena == other.arena) {
+                release();
+                states.reset(other.states.address());
+                other.states.reset(nullptr);
+            } else {
+                void* moved = ops::move_table[other.currentState](arena, other.states.address());
+                release();
+                states.reset(moved);
+            }
+            currentState = other.currentState;
+        }
+        return *this;
+    }
+
+    ~ArenaStateStorage() {
+        release();
+    }
+
+    allocator_type get_allocator() const noexcept {
+        return arena;
+    }
+
+    std::size_t index() const noexcept {
+        return currentState;
+    }
+
+    template <typename State>
+    State& select() {
+        void* entered = ops::template create<State>(arena);
+        release();
+        states.reset(entered);
+        currentState = static_cast<index_type>(type_index_v<State, States...>);
+        return get<State>(states);
+    }
+
+    template <typename Visitor>
+    void visit(Visitor&& visitor) {
+        visit_table<std::remove_reference_t<Visitor>>::lookup_table[currentState](states, visitor);
+    }
+
+protected:
+    live_state<false, States...> states;
+
+private:
+    void release() noexcept {
+        if (states.address() != nullptr) {
+            ops::release_table[currentState](arena, states.address());
+            states.reset(nullptr);
+        }
+    }
+
+    struct ops {
+        /**
+         * @brief Allocate a block for State and construct it from args, deallocating the block
+         * when the constructor throws.
+         */
+        template <typename State, typename... Args>
+        static void* create(Allocator& arena, Args&&... args) {
+            typename traits::template rebind_alloc<State> allocator(arena);
+            using state_traits = typename traits::template rebind_traits<State>;
+            State* state = state_traits::allocate(allocator, 1);
+            try {
+                state_traits::construct(allocator, state, std::forward<Args>(args)...);
+            } catch (...) {
+                state_traits::deallocate(allocator, state, 1);
+                throw;
+            }
+            return state;
+        }
+
+        template <typename State>
+        static void release(Allocator& arena, void* address) noexcept {
+            typename traits::template rebind_alloc<State> allocator(arena);
+            using state_traits = typename traits::template rebind_traits<State>;
+            State* state = static_cast<State*>(address);
+            state_traits::destroy(allocator, state);
+            state_traits::deallocate(allocator, state, 1);
+        }
+
+        template <typename State>
+        static void* copy(Allocator& arena, const void* from) {
+            return create<State>(arena, *static_cast<const State*>(from));
+        }
+
+        template <typename State>
+        static void* move(Allocator& arena, void* from) {
+            return create<State>(arena, std::move(*static_cast<State*>(from)));
+        }
+
+        constexpr static std::array<void (*)(Allocator&, void*) noexcept, sizeof...(States)> release_table = {
+            {&release<States>...}};
+        constexpr static std::array<void* (*)(Allocator&, const void*), sizeof...(States)> copy_table = {
+            {&copy<States>...}};
+        constexpr static std::array<void* (*)(Allocator&, void*), sizeof...(States)> move_table = {
+            {&move<States>...}};
+    };
+
+    template <typename Visitor, typename = std::index_sequence_for<States...>>
+    struct visit_table;
+
+    template <typename Visitor, std::size_t... Idxs>
+    struct visit_table<Visitor, std::index_sequence<Idxs...>> {
+        template <std::size_t Ind>
+        static void visitState(live_state<false, States...>& live, Visitor& visitor) {
+            visitor(&get<Ind>(live));
+        }
+
+        using visit_fun_ptr = void (*)(live_state<false, States...>&, Visitor&);
+
+        constexpr static std::array<visit_fun_ptr, sizeof...(Idxs)> lookup_table = {{&visitState<Idxs>...}};
+    };
+
+    Allocator arena;
+    index_type currentState = 0;
+};
+
+/**
+ * @brief Storage policy selecting ArenaStateStorage with the given allocator.
+ * @code
+ * struct PooledPolicy : fsm::DefaultPolicy {
+ *     using Storage = fsm::ArenaStorage<std::pmr::polymorphic_allocator<std::byte>>;
+ * };
+ * @endcode
+ */
+template <class Allocator>
+struct ArenaStorage {
+    static constexpr bool keeps_all_states = false;
+
+    template <class... States>
+    using storage = ArenaStateStorage<Allocator, States...>;
+};
+
+}  // End of namespace fsm
@@ -0,0 +1,241 @@
+#pragma once
+
+#include <array>
+#include <cstddef>
+#include <memory>
+#include <new>
+#include <tuple>
+#include <type_traits>
+#include <utility>
+
+#include "../tools/StateIndex.hpp"
+#include "../tools/TypeIndex.hpp"
+
+namespace fsm {
+
+/**
+ * @brief The one live state of a machine whose other states do not exist, either held inline in
+ * a buffer sized for the largest state, or at an address handed out by an allocator.
+ * @details get<I> and get<State> reach the current state only. std::tuple_size counts every
+ * state, so that table dispatch indexes it like a tuple of states.
+ */
+template <bool Inline, typename... States>
+class live_state;
+
+template <typename... States>
+class live_state<true, States...> {
+public:
+    void* address() noexcept {
+        return buffer;
+    }
+
+    const void* address() const noexcept {
+        return buffer;
+    }
+
+private:
+    static constexpr std::size_t largest() {
+        constexpr std::size_t sizes[] = {sizeof(States)...};
+        std::size_t size = 0;
+        for (const std::size_t s : sizes) {
+            size = s > size ? s : size;
+        }
+        return size;
+    }
+
+    alignas(States...) unsigned char buffer[largest()];
+};
+
+template <typename... States>
+class live_state<false, States...> {
+public:
+    void* address() noexcept {
+        return pointer;
+    }
+
+    const void* address() const noexcept {
+        return pointer;
+    }
+
+    void reset(void* address) noexcept {
+        pointer = address;
+    }
+
+private:
+    void* pointer = nullptr;
+};
+
+template <std::size_t I, bool Inline, typename... States>
+std::tuple_element_t<I, std::tuple<States...>>& get(live_state<Inline, States...>& live) noexcept {
+    return *std::launder(static_cast<std::tuple_element_t<I, std::tuple<States...>>*>(live.address()));
+}
+
+template <std::size_t I, bool Inline, typename... States>
+const std::tuple_element_t<I, std::tuple<States...>>& get(const live_state<Inline, States...>& live) noexcept {
+    return *std::launder(static_cast<const std::tuple_element_t<I, std::tuple<States...>>*>(live.address()));
+}
+
+template <typename State, bool Inline, typename... States>
+State& get(live_state<Inline, States...>& live) noexcept {
+    return get<type_index_v<State, States...>>(live);
+}
+
+template <typename State, bool Inline, typename... States>
+const State& get(const live_state<Inline, States...>& live) noexcept {
+    return get<type_index_v<State, States...>>(live);
+}
+
+/**
+ * @brief Keeps only the current state, in place in a buffer sized for the largest one, so that
+ * a machine takes max(sizeof(States)) instead of their sum.
+ * @details Entering a state, self-transitions included, default constructs it after the
+ * previous state is destroyed, hence between its onLeave and the onEnter of the target.
+ * state<State>() is only valid for the current state, and a machine cannot be built from
+ * states, only default constructed in its first state.
+ */
+template <class... States>
+class InPlaceStateStorage {
+    static_assert((std::is_nothrow_default_constructible_v<States> && ...),
+                  "in-place states are default constructed on entry, after the previous state is gone");
+
+public:
+    using index_type = state_index_t<sizeof...(States)>;
+
+    InPlaceStateStorage() noexcept {
+        ::new (states.address()) std::tuple_element_t<0, std::tuple<States...>>();
+    }
+
+    InPlaceStateStorage(States... states_in) = delete;
+
+    InPlaceStateStorage(const InPlaceStateStorage& other) : currentState(other.currentState) {
+        ops::copy_table[currentState](states.address(), other.states.address());
+    }
+
+    InPlaceStateStorage(InPlaceStateStorage&& other) noexcept(
+        (std::is_nothrow_move_constructible_v<States> && ...))
+        : currentState(other.currentState) {
+        ops::move_table[currentState](states.address(), other.states.address());
+    }
+
+    /**
+     * @brief Destroy the current state, then copy the state of other; should the copy throw, the
+     * storage is back in its first state.
+     */
+    InPlaceStateStorage& operator=(const InPlaceStateStorage& other) {
+        if (this != &other) {
+            replace([&other](void* to) { ops::copy_table[other.currentState](to, other.states.address()); },
+                    other.currentState);
+        }
+        return *this;
+    }
+
+    InPlaceStateStorage& operator=(InPlaceStateStorage&& other) noexcept(
+        (std::is_nothrow_move_constructible_v<States> && ...)) {
+        if (this != &other) {
+            replace([&other](void* to) { ops::move_table[other.currentState](to, other.states.address()); },
+                    other.currentState);
+        }
+        return *this;
+    }
+
+    ~InPlaceStateStorage() {
+        ops::destroy_table[currentState](states.address());
+    }
+
+    std::size_t index() const noexcept {
+        return currentState;
+    }
+
+    template <typename State>
+    State& select() noexcept {
+        ops::destroy_table[currentState](states.address());
+        ::new (states.address()) State();
+        currentState = static_cast<index_type>(type_index_v<State, States...>);
+        return get<State>(states);
+    }
+
+    template <typename Visitor>
+    void visit(Visitor&& visitor) {
+        visit_table<std::remove_reference_t<Visitor>>::lookup_table[currentState](states, visitor);
+    }
+
+protected:
+    live_state<true, States...> states;
+    index_type currentState = 0;
+
+private:
+    template <typename Construct>
+    void replace(Construct&& construct, index_type index) {
+        ops::destroy_table[currentState](states.address());
+        try {
+            construct(states.address());
+            currentState = index;
+        } catch (...) {
+            ::new (states.address()) std::tuple_element_t<0, std::tuple<States...>>();
+            currentState = 0;
+            throw;
+        }
+    }
+
+    struct ops {
+        template <typename State>
+        static void destroy(void* state) noexcept {
+            std::destroy_at(static_cast<State*>(state));
+        }
+
+        template <typename State>
+        static void copy(void* to, const void* from) {
+            ::new (to) State(*static_cast<const State*>(from));
+        }
+
+        template <typename State>
+        static void move(void* to, void* from) noexcept(std::is_nothrow_move_constructible_v<State>) {
+            ::new (to) State(std::move(*static_cast<State*>(from)));
+        }
+
+        constexpr static std::array<void (*)(void*) noexcept, sizeof...(States)> destroy_table = {
+            {&destroy<States>...}};
+        constexpr static std::array<void (*)(void*, const void*), sizeof...(States)> copy_table = {{&copy<States>...}};
+        constexpr static std::array<void (*)(void*, void*), sizeof...(States)> move_table = {{&move<States>...}};
+    };
+
+    template <typename Visitor, typename = std::index_sequence_for<States...>>
+    struct visit_table;
+
+    template <typename Visitor, std::size_t... Idxs>
+    struct visit_table<Visitor, std::index_sequence<Idxs...>> {
+        template <std::size_t Ind>
+        static void visitState(live_state<true, States...>& live, Visitor& visitor) {
+            visitor(&get<Ind>(live));
+        }
+
+        using visit_fun_ptr = void (*)(live_state<true, States...>&, Visitor&);
+
+        constexpr static std::array<visit_fun_ptr, sizeof...(Idxs)> lookup_table = {{&visitState<Idxs>...}};
+    };
+};
+
+/**
+ * @brief Storage policy selecting InPlaceStateStorage.
+ */
+struct InPlaceStorage {
+    static constexpr bool keeps_all_states = false;
+
+    template <class... States>
+    using storage = InPlaceStateStorage<States...>;
+};
+
+}  // End of namespace fsm
+
+namespace std {
+
+template <bool Inline, typename... States>
+struct tuple_size<fsm::live_state<Inline, States...>> : integral_constant<size_t, sizeof...(States)> {
+};
+
+template <size_t I, bool Inline, typename... States>
+struct tuple_element<I, fsm::live_state<Inline, States...>> {
+    using type = tuple_element_t<I, tuple<States...>>;
+};
+
+}  // End of namespace std
@@ -0,0 +1,73 @@
+#pragma once
+
+#include <array>
+#include <utility>
+
+#include "../tools/FlatTuple.hpp"
+#include "../tools/StateIndex.hpp"
+#include "../tools/TypeIndex.hpp"
+
+namespace fsm {
+
+/**
+ * @brief Keeps every state in a flat_tuple and remembers the current one as a small integer.
+ * @details The index type is picked from the number of states (see state_index_t), and
+ * copying or moving is member-wise, so it is trivial whenever the states are.
+ */
+template <class... States>
+class IndexStateStorage {
+public:
+    using index_type = state_index_t<sizeof...(States)>;
+
+    IndexStateStorage() = default;
+
+    constexpr IndexStateStorage(States... states_in) : states(std::move(states_in)...) {
+    }
+
+    constexpr std::size_t index() const noexcept {
+        return currentState;
+    }
+
+    template <typename State>
+    constexpr State& select() noexcept {
+        currentState = static_cast<index_type>(type_index_v<State, States...>);
+        return get<State>(states);
+    }
+
+    template <typename Visitor>
+    constexpr void visit(Visitor&& visitor) {
+        visit_table<std::remove_reference_t<Visitor>>::lookup_table[currentState](states, visitor);
+    }
+
+protected:
+    flat_tuple<States...> states;
+    index_type currentState = 0;
+
+private:
+    template <typename Visitor, typename = std::index_sequence_for<States...>>
+    struct visit_table;
+
+    template <typename Visitor, std::size_t... Idxs>
+    struct visit_table<Visitor, std::index_sequence<Idxs...>> {
+        template <std::size_t Ind>
+        static constexpr void visitState(flat_tuple<States...>& tuple, Visitor& visitor) {
+            visitor(&get<Ind>(tuple));
+        }
+
+        using visit_fun_ptr = void (*)(flat_tuple<States...>&, Visitor&);
+
+        constexpr static std::array<visit_fun_ptr, sizeof...(Idxs)> lookup_table = {{&visitState<Idxs>...}};
+    };
+};
+
+/**
+ * @brief Storage policy selecting IndexStateStorage.
+ */
+struct IndexStorage {
+    static constexpr bool keeps_all_states = true;
+
+    template <class... States>
+    using storage = IndexStateStorage<States...>;
+};
+
+}  // End of namespace fsm
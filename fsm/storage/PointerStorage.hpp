@@ -0,0 +1,82 @@
+#pragma once
+
+#include <tuple>
+#include <utility>
+#include <variant>
+
+#include "../tools/TupleTools.hpp"
+
+namespace fsm {
+
+/**
+ * @brief Keeps every state in a tuple and points at the current one through
+ * std::variant<States*...>.
+ * @details Usable in constant expressions from C++20 on, where assigning a std::variant is
+ * constexpr.
+ */
+template <class... States>
+class PointerStateStorage {
+public:
+    constexpr PointerStateStorage() : currentState(&std::get<0>(states)) {
+    }
+
+    constexpr PointerStateStorage(States... states_in) : states(std::move(states_in)...) {
+        currentState = &std::get<0>(states);
+    }
+
+    constexpr PointerStateStorage(const PointerStateStorage& other) : states(other.states) {
+        currentState = runtime_get(states, other.currentState.index());
+    }
+
+    constexpr PointerStateStorage(PointerStateStorage&& other) : states(std::move(other.states)) {
+        currentState = runtime_get(states, other.currentState.index());
+    }
+
+    constexpr PointerStateStorage& operator=(const PointerStateStorage& other) {
+        if (this != &other) {
+            states = other.states;
+            currentState = runtime_get(states, other.currentState.index());
+        }
+        return *this;
+    }
+
+    constexpr PointerStateStorage& operator=(PointerStateStorage&& other) {
+        if (this != &other) {
+            states = std::move(other.states);
+            currentState = runtime_get(states, other.currentState.index());
+        }
+        return *this;
+    }
+
+    constexpr std::size_t index() const noexcept {
+        return currentState.index();
+    }
+
+    template <typename State>
+    constexpr State& select() noexcept {
+        State& state = std::get<State>(states);
+        currentState = &state;
+        return state;
+    }
+
+    template <typename Visitor>
+    constexpr void visit(Visitor&& visitor) {
+        std::visit(std::forward<Visitor>(visitor), currentState);
+    }
+
+protected:
+    std::tuple<States...> states;
+    std::variant<States*...> currentState;
+};
+
+/**
+ * @brief Storage policy selecting PointerStateStorage.
+ */
+struct PointerStorage {
+    static constexpr bool keeps_all_states = true;
+
+    template <class... States>
+    using storage = PointerStateStorage<States...>;
+};
+
+}  // End of namespace fsm
@@ -0,0 +1,86 @@
+#pragma once
+
+#include <cstddef>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+namespace fsm {
+
+/**
+ * @brief One column of a MachinePool: the payload of a single state type for every machine.
+ * @details Empty states carry no payload, so their column holds one shared instance instead
+ * of one element per machine.
+ * @tparam State : state type stored in the column.
+ */
+template <typename State, bool = std::is_empty_v<State>>
+class PoolColumn {
+public:
+    State& at(std::size_t id) noexcept {
+        return values[id];
+    }
+
+    const State& at(std::size_t id) const noexcept {
+        return values[id];
+    }
+
+    void push_back(State state) {
+        values.push_back(std::move(state));
+    }
+
+    State* data() noexcept {
+        return values.data();
+    }
+
+    const State* data() const noexcept {
+        return values.data();
+    }
+
+    std::size_t size() const noexcept {
+        return values.size();
+    }
+
+    void reserve(std::size_t count) {
+        values.reserve(count);
+    }
+
+    void resize(std::size_t count) {
+        values.resize(count);
+    }
+
+    void clear() {
+        values.clear();
+    }
+
+private:
+    std::vector<State> values;
+};
+
+template <typename State>
+class PoolColumn<State, true> {
+public:
+    State& at(std::size_t) noexcept {
+        return value;
+    }
+
+    const State& at(std::size_t) const noexcept {
+        return value;
+    }
+
+    void push_back(const State&) {
+    }
+
+    void reserve(std::size_t) {
+    }
+
+    void resize(std::size_t) {
+    }
+
+    void clear() {
+    }
+
+private:
+    State value;
+};
+
+}  // End of namespace fsm
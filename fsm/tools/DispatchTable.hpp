@@ -0,0 +1,152 @@
+#pragma once
+
+#include <array>
+#include <tuple>
+#include <type_traits>
+#include <utility>
+
+#include "../policies/Observer.hpp"
+#include "FlatTuple.hpp"
+#include "StateTraits.hpp"
+
+namespace fsm {
+
+/**
+ * @struct state_dispatch_table
+ * @brief Generates a lookup-table (LUT), during compile time, that dispatches one event type
+ * to each state held in an std::tuple.
+ * @details Entry Ind of the LUT asks the Ind'th state how to react to the event and executes
+ * the returned action, so handling an event becomes a single indirect call indexed by the
+ * current state.
+ * @tparam Machine : type of the machine passed to the actions.
+ * @tparam Event : type of the dispatched event.
+ * @tparam TemplateTuple : type of the tuple holding the states.
+ * @tparam Idxs : indices to the tuple (parameter pack).
+ */
+template <typename Machine, typename Event, typename TemplateTuple, std::size_t... Idxs>
+struct state_dispatch_table
+{
+	using tuple_type = TemplateTuple;
+	using machine_type = Machine;
+	using event_type = Event;
+	const static auto table_size = sizeof...(Idxs);
+
+	/**
+	 * @brief Pass the event to the Ind'th state and execute the resulting action.
+	 * @tparam Ind : Index
+	 * @param[in] states : tuple of states.
+	 * @param[in] machine : machine the action is executed on.
+	 * @param[in] event : dispatched event.
+	 */
+	template <std::size_t Ind>
+	static constexpr void dispatchToState(tuple_type& states, machine_type& machine, const event_type& event)
+	{
+		using std::get;
+		auto& state = get<Ind>(states);
+		notify_dispatch<machine_type, std::remove_reference_t<decltype(state)>, event_type>(event);
+		auto action = state.handle(event);
+		action.execute(machine, state, event);
+	}
+
+	/**
+	 * @brief Shared entry of the states that do not react to the event.
+	 */
+	static constexpr void ignore(tuple_type&, machine_type&, const event_type&) noexcept
+	{
+	}
+
+	/**
+	 * @brief Whether the Ind'th state has an entry other than ignore.
+	 */
+	template <std::size_t Ind>
+	static constexpr bool reacts()
+	{
+		return handles_v<std::tuple_element_t<Ind, tuple_type>, event_type> || is_observed_v<machine_type>;
+	}
+
+	/**
+	 * @brief Dispatch function pointer type.
+	 */
+	using dispatch_fun_ptr = void (*)(tuple_type&, machine_type&, const event_type&);
+
+	/**
+	 * @brief Table entry of the Ind'th state, ignore when its handler is Nothing and the
+	 * machine does not observe unhandled events.
+	 */
+	template <std::size_t Ind>
+	static constexpr dispatch_fun_ptr entry()
+	{
+		if constexpr (reacts<Ind>()) {
+			return &dispatchToState<Ind>;
+		} else {
+			return &ignore;
+		}
+	}
+
+	/**
+	 * @brief std::array containing dispatch functions for each state.
+	 */
+	constexpr static std::array<dispatch_fun_ptr, table_size> lookup_table = {{entry<Idxs>()...}};
+};
+
+/**
+ * @brief Convenience function for calling state_dispatch_table in order to
+ * automatically deduce templated types.
+ * @tparam TemplateTuple : tuple type.
+ * @tparam Machine : machine type.
+ * @tparam Event : event type.
+ * @tparam Idxs : index parameter pack.
+ * @param[in] states : tuple of states.
+ * @param[in] i : index of the current state.
+ * @param[in] machine : machine the action is executed on.
+ * @param[in] event : dispatched event.
+ */
+template <typename TemplateTuple, typename Machine, typename Event, std::size_t... Idxs>
+constexpr void call_dispatch_function(TemplateTuple& states, std::size_t i, Machine& machine, const Event& event,
+                            std::index_sequence<Idxs...>)
+{
+	auto& table = state_dispatch_table<Machine, Event, TemplateTuple, Idxs...>::lookup_table;
+	table[i](states, machine, event);
+}
+
+/**
+ * @brief Largest number of states dispatched with inline comparisons instead of an indirect
+ * call through the table (see runtime_dispatch).
+ */
+constexpr std::size_t inline_dispatch_limit = 16;
+
+/**
+ * @brief Compare i with the index of every state reacting to the event and run the matching
+ * entry of the table inline, so that the compiler sees the handler.
+ */
+template <typename TemplateTuple, typename Machine, typename Event, std::size_t... Idxs>
+constexpr void call_dispatch_inline(TemplateTuple& states, std::size_t i, Machine& machine, const Event& event,
+                            std::index_sequence<Idxs...>)
+{
+	using table = state_dispatch_table<Machine, Event, TemplateTuple, Idxs...>;
+	(void)((table::template reacts<Idxs>() && i == Idxs &&
+	        (table::template dispatchToState<Idxs>(states, machine, event), true)) || ...);
+}
+
+/**
+ * @brief Dispatch an event to the i'th state of a tuple in runtime.
+ * @details Tuples of up to inline_dispatch_limit states go through inline comparisons, larger
+ * ones through one indirect call.
+ * @tparam TemplateTuple : type of the std::tuple.
+ * @param[in] states : tuple of states.
+ * @param[in] i : index of the current state.
+ * @param[in] machine : machine the action is executed on.
+ * @param[in] event : dispatched event.
+ */
+template <typename TemplateTuple, typename Machine, typename Event>
+constexpr void runtime_dispatch(TemplateTuple& states, std::size_t i, Machine& machine, const Event& event)
+{
+	constexpr std::size_t size = std::tuple_size_v<TemplateTuple>;
+	if constexpr (size <= inline_dispatch_limit) {
+		call_dispatch_inline(states, i, machine, event, std::make_index_sequence<size>{});
+	} else {
+		call_dispatch_function(states, i, machine, event, std::make_index_sequence<size>{});
+	}
+}
+
+}  // End of namespace fsm
@@ -0,0 +1,40 @@
+#pragma once
+
+namespace fsm {
+
+/**
+ * @brief Out-of-line entry point for dispatching one event type to a machine.
+ * @details BasicStateMachine::handle() goes through this struct instead of expanding the
+ * dispatch inline. Because dispatch() is not defined inside the class body it is not implicitly
+ * inline, so an explicit instantiation declaration (FSM_EXTERN_DISPATCH) keeps a translation
+ * unit from instantiating the state handlers and transition code for that event at all; a single
+ * translation unit provides them with FSM_INSTANTIATE_DISPATCH. Large machines can spread their
+ * events over several translation units that way.
+ * @tparam Machine : BasicStateMachine specialization.
+ * @tparam Event : event type.
+ */
+template <typename Machine, typename Event>
+struct event_dispatcher
+{
+	static void dispatch(Machine& machine, const Event& event);
+};
+
+template <typename Machine, typename Event>
+void event_dispatcher<Machine, Event>::dispatch(Machine& machine, const Event& event)
+{
+	machine.handleBy(event, machine);
+}
+
+}  // End of namespace fsm
+
+/**
+ * @brief Declare that dispatching Event to Machine is instantiated in another translation unit.
+ * @details Machine is the BasicStateMachine specialization (e.g. through a using-declaration),
+ * not a class derived from it. Place at namespace scope after Machine and Event are complete.
+ */
+#define FSM_EXTERN_DISPATCH(Machine, Event) extern template struct fsm::event_dispatcher<Machine, Event>
+
+/**
+ * @brief Instantiate dispatching Event to Machine in this translation unit.
+ */
+#define FSM_INSTANTIATE_DISPATCH(Machine, Event) template struct fsm::event_dispatcher<Machine, Event>
@@ -0,0 +1,320 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <utility>
+
+#include "Span.hpp"
+
+#if __has_include(<sys/mman.h>) && __has_include(<fcntl.h>) && __has_include(<unistd.h>)
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#define FSM_HAS_MMAP 1
+#else
+#define FSM_HAS_MMAP 0
+#endif
+
+namespace fsm {
+
+/**
+ * @brief Header opening every event log.
+ * @details Fields are in host byte order, like snapshots. used counts the bytes of records
+ * following the header; it is updated after each record is complete, so a log cut short by a
+ * crash ends on a record boundary.
+ */
+struct event_log_header {
+    std::uint32_t magic;
+    std::uint16_t version;
+    std::uint16_t reserved;
+    std::uint64_t used;
+    std::uint64_t count;
+    std::uint64_t dropped;
+};
+
+/**
+ * @brief Record of one event: its payload, size bytes padded to event_log_alignment, follows.
+ */
+struct event_log_record {
+    std::uint64_t timestamp;
+    std::uint32_t type;
+    std::uint32_t size;
+};
+
+constexpr std::uint32_t event_log_magic = 0x4c565346;  // "FSVL"
+constexpr std::uint16_t event_log_version = 1;
+constexpr std::size_t event_log_alignment = 8;
+
+constexpr std::size_t event_log_padded(std::size_t size) noexcept {
+    return (size + event_log_alignment - 1) & ~(event_log_alignment - 1);
+}
+
+/**
+ * @brief A file mapped in memory, unmapped on destruction; an empty mapping where mmap is not
+ * available.
+ */
+class mapped_file {
+public:
+    mapped_file() noexcept = default;
+
+    mapped_file(mapped_file&& other) noexcept
+        : address(std::exchange(other.address, nullptr)), length(std::exchange(other.length, 0)) {
+    }
+
+    mapped_file& operator=(mapped_file&& other) noexcept {
+        if (this != &other) {
+            unmap();
+            address = std::exchange(other.address, nullptr);
+            length = std::exchange(other.length, 0);
+        }
+        return *this;
+    }
+
+    ~mapped_file() {
+        unmap();
+    }
+
+    /**
+     * @brief Map path for writing, creating it or resizing it to size bytes.
+     * @return false, with errno set, when the file cannot be created or mapped.
+     */
+    bool create(const char* path, std::size_t size) noexcept {
+#if FSM_HAS_MMAP
+        const int fd = ::open(path, O_RDWR | O_CREAT | O_TRUNC, 0644);
+        if (fd < 0) {
+            return false;
+        }
+        const bool mapped = ::ftruncate(fd, static_cast<off_t>(size)) == 0 && map(fd, size, PROT_READ | PROT_WRITE);
+        ::close(fd);
+        return mapped;
+#else
+        (void)path;
+        (void)size;
+        return false;
+#endif
+    }
+
+    /**
+     * @brief Map the whole of path for reading.
+     */
+    bool open(const char* path) noexcept {
+#if FSM_HAS_MMAP
+        const int fd = ::open(path, O_RDONLY);
+        if (fd < 0) {
+            return false;
+        }
+        struct stat status;
+        const bool mapped = ::fstat(fd, &status) == 0 && map(fd, static_cast<std::size_t>(status.st_size), PROT_READ);
+        ::close(fd);
+        return mapped;
+#else
+        (void)path;
+        return false;
+#endif
+    }
+
+    std::byte* data() const noexcept {
+        return static_cast<std::byte*>(address);
+    }
+
+    std::size_t size() const noexcept {
+        return length;
+    }
+
+private:
+#if FSM_HAS_MMAP
+    bool map(int fd, std::size_t size, int protection) noexcept {
+        unmap();
+        if (size == 0) {
+            return false;
+        }
+        void* mapping = ::mmap(nullptr, size, protection, MAP_SHARED, fd, 0);
+        if (mapping == MAP_FAILED) {
+            return false;
+        }
+        address = mapping;
+        length = size;
+        return true;
+    }
+#endif
+
+    void unmap() noexcept {
+#if FSM_HAS_MMAP
+        if (address != nullptr) {
+            ::munmap(address, length);
+        }
+#endif
+        address = nullptr;
+        length = 0;
+    }
+
+    void* address = nullptr;
+    std::size_t length = 0;
+};
+
+/**
+ * @brief Append-only log of event records in a preallocated region: caller memory or a mapped
+ * file.
+ * @details Appending copies the record into the region and never allocates; once the region is
+ * full, records are dropped and counted. The region starts with an event_log_header and has to
+ * be aligned to event_log_alignment.
+ */
+class EventLog {
+public:
+    EventLog() noexcept = default;
+
+    explicit EventLog(span<std::byte> region) noexcept {
+        reset(region);
+    }
+
+    // Recorders point to the log.
+    EventLog(const EventLog&) = delete;
+    EventLog& operator=(const EventLog&) = delete;
+
+    /**
+     * @brief Log into path, created or truncated to capacity bytes and mapped in memory.
+     * @return false, with errno set, when the file cannot be created or mapped.
+     */
+    bool create(const char* path, std::size_t capacity) noexcept {
+        if (capacity < sizeof(event_log_header) || !file.create(path, capacity)) {
+            return false;
+        }
+        reset(span<std::byte>(file.data(), file.size()));
+        return true;
+    }
+
+    bool isOpen() const noexcept {
+        return header != nullptr;
+    }
+
+    /**
+     * @brief Append a record holding the size bytes at payload.
+     * @return false when the record does not fit, it is then dropped.
+     */
+    bool append(std::uint32_t type, std::uint64_t timestamp, const void* payload, std::uint32_t size) noexcept {
+        const std::size_t length = sizeof(event_log_record) + event_log_padded(size);
+        if (header == nullptr || length > capacity - end) {
+            if (header != nullptr) {
+                ++header->dropped;
+            }
+            return false;
+        }
+        std::byte* record = base + end;
+        const event_log_record head{timestamp, type, size};
+        std::memcpy(record, &head, sizeof(head));
+        std::memcpy(record + sizeof(head), payload, size);
+        end += length;
+        header->used = end - sizeof(event_log_header);
+        ++header->count;
+        return true;
+    }
+
+    std::uint64_t count() const noexcept {
+        return header != nullptr ? header->count : 0;
+    }
+
+    std::uint64_t dropped() const noexcept {
+        return header != nullptr ? header->dropped : 0;
+    }
+
+    /**
+     * @brief The log written so far, header included, as read by EventLogReader.
+     */
+    span<const std::byte> bytes() const noexcept {
+        return span<const std::byte>(base, end);
+    }
+
+private:
+    void reset(span<std::byte> region) noexcept {
+        if (region.size() < sizeof(event_log_header)) {
+            return;
+        }
+        base = region.data();
+        capacity = region.size();
+        end = sizeof(event_log_header);
+        header = reinterpret_cast<event_log_header*>(base);
+        *header = event_log_header{event_log_magic, event_log_version, 0, 0, 0, 0};
+    }
+
+    mapped_file file;
+    std::byte* base = nullptr;
+    event_log_header* header = nullptr;
+    std::size_t capacity = 0;
+    std::size_t end = 0;
+};
+
+/**
+ * @brief Reader of an event log, in memory or mapped from a file.
+ */
+class EventLogReader {
+public:
+    EventLogReader() noexcept = default;
+
+    EventLogReader(const EventLogReader&) = delete;
+    EventLogReader& operator=(const EventLogReader&) = delete;
+
+    /**
+     * @brief Read the log held by bytes, which must outlive the reader.
+     * @return false for a truncated or foreign log.
+     */
+    bool open(span<const std::byte> bytes) noexcept {
+        records = {};
+        event_log_header header;
+        if (bytes.size() < sizeof(header)) {
+            return false;
+        }
+        std::memcpy(&header, bytes.data(), sizeof(header));
+        if (header.magic != event_log_magic || header.version != event_log_version ||
+            header.used > bytes.size() - sizeof(header)) {
+            return false;
+        }
+        records = bytes.subspan(sizeof(header), static_cast<std::size_t>(header.used));
+        recordCount = header.count;
+        return true;
+    }
+
+    /**
+     * @brief Map path and read the log it holds.
+     */
+    bool open(const char* path) noexcept {
+        return file.open(path) && open(span<const std::byte>(file.data(), file.size()));
+    }
+
+    std::uint64_t count() const noexcept {
+        return recordCount;
+    }
+
+    /**
+     * @brief Call sink(record, payload) for every record, in order, while it returns true.
+     * @return false when a record is malformed or sink stopped.
+     */
+    template <typename Sink>
+    bool forEach(Sink&& sink) const {
+        std::size_t offset = 0;
+        while (offset < records.size()) {
+            event_log_record record;
+            if (records.size() - offset < sizeof(record)) {
+                return false;
+            }
+            std::memcpy(&record, records.data() + offset, sizeof(record));
+            const std::size_t length = sizeof(record) + event_log_padded(record.size);
+            if (length > records.size() - offset) {
+                return false;
+            }
+            if (!sink(record, records.subspan(offset + sizeof(record), record.size))) {
+                return false;
+            }
+            offset += length;
+        }
+        return true;
+    }
+
+private:
+    mapped_file file;
+    span<const std::byte> records;
+    std::uint64_t recordCount = 0;
+};
+
+}  // End of namespace fsm
@@ -0,0 +1,124 @@
+#pragma once
+
+#include <cstddef>
+#include <cstring>
+#include <type_traits>
+
+#include "Span.hpp"
+
+namespace fsm {
+
+/**
+ * @brief Non-owning event over the bytes of a received frame, decoding a field only when it is
+ * read.
+ * @details Derive one view per message type and name its fields with field<T, Offset>().
+ * Machines handle views like any other event, by const reference, so that a frame goes from the
+ * receive buffer to the handlers and to onEnter/onLeave hooks without being copied into an event
+ * struct. A view must not outlive its frame, which matters for views posted to a queue.
+ * A view declaring a static min_size is only built by BasicStateMachine::handleTagged over
+ * frames of at least min_size bytes, so that its fixed fields can be read unchecked; the other
+ * fields are checked with fits() or read with tryField().
+ * @code
+ * struct OrderView : fsm::EventView {
+ *     using EventView::EventView;
+ *     static constexpr std::size_t min_size = 16;
+ *     std::uint64_t price() const { return field<std::uint64_t, 8>(); }
+ * };
+ * struct Idle : fsm::Will<fsm::ByDefault<fsm::Nothing>, fsm::On<OrderView, fsm::TransitionTo<Busy>>> {};
+ * @endcode
+ */
+class EventView {
+public:
+    constexpr EventView() noexcept = default;
+
+    constexpr explicit EventView(span<const std::byte> frame) noexcept : frame(frame) {
+    }
+
+    constexpr span<const std::byte> bytes() const noexcept {
+        return frame;
+    }
+
+    constexpr std::size_t size() const noexcept {
+        return frame.size();
+    }
+
+    /**
+     * @brief Whether the frame holds at least Size bytes, e.g. Offset + sizeof(T) before
+     * reading several fields up to there.
+     */
+    template <std::size_t Size>
+    constexpr bool fits() const noexcept {
+        return frame.size() >= Size;
+    }
+
+    constexpr bool fits(std::size_t size) const noexcept {
+        return frame.size() >= size;
+    }
+
+protected:
+    /**
+     * @brief Field of type T stored at Offset in the frame, in host byte order and with any
+     * alignment; the frame has to hold Offset + sizeof(T) bytes.
+     */
+    template <typename T, std::size_t Offset>
+    T field() const noexcept {
+        return field<T>(Offset);
+    }
+
+    template <typename T>
+    T field(std::size_t offset) const noexcept {
+        static_assert(std::is_trivially_copyable_v<T> && std::is_default_constructible_v<T>,
+                      "view fields are copied from their bytes");
+        T value;
+        std::memcpy(&value, frame.data() + offset, sizeof(T));
+        return value;
+    }
+
+    /**
+     * @brief Checked field(): copy the field of type T at Offset into value when the frame
+     * holds it.
+     * @return false, leaving value untouched, when the frame is too short.
+     */
+    template <typename T, std::size_t Offset>
+    bool tryField(T& value) const noexcept {
+        if (!fits<Offset + sizeof(T)>()) {
+            return false;
+        }
+        value = field<T>(Offset);
+        return true;
+    }
+
+    /**
+     * @brief Bytes of the frame from offset on, e.g. a variable-length trailer.
+     */
+    constexpr span<const std::byte> tail(std::size_t offset) const noexcept {
+        return frame.subspan(offset);
+    }
+
+private:
+    span<const std::byte> frame;
+};
+
+/**
+ * @brief Whether Event is a view built over the bytes of its frame rather than copied from them.
+ */
+template <typename Event>
+constexpr bool is_event_view_v = std::is_constructible_v<Event, span<const std::byte>>;
+
+template <typename Event, typename = void>
+struct declared_min_size : std::integral_constant<std::size_t, 0> {
+};
+
+template <typename Event>
+struct declared_min_size<Event, std::void_t<decltype(Event::min_size)>>
+    : std::integral_constant<std::size_t, Event::min_size> {
+};
+
+/**
+ * @brief Number of bytes a frame needs to hold Event: the size of an event copied from its
+ * bytes, or the min_size of a view (0 when it declares none).
+ */
+template <typename Event>
+constexpr std::size_t min_frame_size_v = is_event_view_v<Event> ? declared_min_size<Event>::value : sizeof(Event);
+
+}  // End of namespace fsm
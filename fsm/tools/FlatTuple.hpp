@@ -0,0 +1,117 @@
+#pragma once
+
+#include <cstddef>
+#include <tuple>
+#include <type_traits>
+#include <utility>
+
+namespace fsm {
+
+template <typename... Ts>
+struct flat_tuple;
+
+template <typename T>
+struct is_flat_tuple : std::false_type {
+};
+
+template <typename... Ts>
+struct is_flat_tuple<flat_tuple<Ts...>> : std::true_type {
+};
+
+/**
+ * @brief I'th element of a flat_tuple, empty types are stored as a base class.
+ * @details Nested flat_tuples are stored as members, or their leaves would become ambiguous
+ * bases of the enclosing tuple.
+ */
+template <std::size_t I, typename T, bool = std::is_empty_v<T> && !std::is_final_v<T> && !is_flat_tuple<T>::value>
+struct flat_tuple_leaf {
+    constexpr flat_tuple_leaf() = default;
+
+    constexpr flat_tuple_leaf(T v) : value(std::move(v)) {
+    }
+
+    constexpr T& get() noexcept {
+        return value;
+    }
+
+    constexpr const T& get() const noexcept {
+        return value;
+    }
+
+    T value;
+};
+
+template <std::size_t I, typename T>
+struct flat_tuple_leaf<I, T, true> : T {
+    constexpr flat_tuple_leaf() = default;
+
+    constexpr flat_tuple_leaf(T v) : T(std::move(v)) {
+    }
+
+    constexpr T& get() noexcept {
+        return *this;
+    }
+
+    constexpr const T& get() const noexcept {
+        return *this;
+    }
+};
+
+template <typename Indices, typename... Ts>
+struct flat_tuple_impl;
+
+template <std::size_t... Is, typename... Ts>
+struct flat_tuple_impl<std::index_sequence<Is...>, Ts...> : flat_tuple_leaf<Is, Ts>... {
+    constexpr flat_tuple_impl() = default;
+
+    constexpr flat_tuple_impl(Ts... values) : flat_tuple_leaf<Is, Ts>(std::move(values))... {
+    }
+};
+
+/**
+ * @brief Tuple whose elements are all direct bases of one class.
+ * @details Unlike std::tuple, which nests one level of inheritance per element, the number
+ * of nested instantiations does not grow with the number of elements, and access by index or
+ * by type is a single derived-to-base conversion. Copy and move are member-wise, so they are
+ * trivial whenever the elements' are.
+ * @tparam Ts : element types, all distinct.
+ */
+template <typename... Ts>
+struct flat_tuple : flat_tuple_impl<std::index_sequence_for<Ts...>, Ts...> {
+    using flat_tuple_impl<std::index_sequence_for<Ts...>, Ts...>::flat_tuple_impl;
+};
+
+template <std::size_t I, typename T>
+constexpr T& get(flat_tuple_leaf<I, T>& leaf) noexcept {
+    return leaf.get();
+}
+
+template <std::size_t I, typename T>
+constexpr const T& get(const flat_tuple_leaf<I, T>& leaf) noexcept {
+    return leaf.get();
+}
+
+template <typename T, std::size_t I>
+constexpr T& get(flat_tuple_leaf<I, T>& leaf) noexcept {
+    return leaf.get();
+}
+
+template <typename T, std::size_t I>
+constexpr const T& get(const flat_tuple_leaf<I, T>& leaf) noexcept {
+    return leaf.get();
+}
+
+}  // End of namespace fsm
+
+namespace std {
+
+template <typename... Ts>
+struct tuple_size<fsm::flat_tuple<Ts...>> : integral_constant<size_t, sizeof...(Ts)> {
+};
+
+template <size_t I, typename... Ts>
+struct tuple_element<I, fsm::flat_tuple<Ts...>> {
+    using type = tuple_element_t<I, tuple<Ts...>>;
+};
+
+}  // End of namespace std
@@ -0,0 +1,126 @@
+#pragma once
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <type_traits>
+
+#if defined(__AVX2__) || defined(__SSSE3__)
+#include <immintrin.h>
+#elif defined(__ARM_NEON) && defined(__aarch64__)
+#include <arm_neon.h>
+#endif
+
+namespace fsm {
+
+/**
+ * @brief Call f for each set bit of mask, passing base plus the position of the bit.
+ */
+template <typename Function>
+inline void for_each_set_bit(std::uint32_t mask, std::size_t base, Function& f)
+{
+	while (mask != 0) {
+#if defined(__GNUC__)
+		const auto bit = static_cast<std::size_t>(__builtin_ctz(mask));
+#else
+		std::size_t bit = 0;
+		while (((mask >> bit) & 1u) == 0) {
+			++bit;
+		}
+#endif
+		f(base + bit);
+		mask &= mask - 1;
+	}
+}
+
+/**
+ * @brief Rewrite a dense array of state indices through a transition table.
+ * @details Performs indices[i] = next[indices[i]] for every i. When HasGeneric is set, onGeneric(i)
+ * is then called for every position whose state is flagged in generic; those states must map to
+ * themselves in next. Byte-sized indices of machines with at most 16 states are remapped with
+ * byte shuffles (AVX2: 32 machines per instruction, SSSE3/NEON: 16), anything else falls back
+ * to a scalar loop.
+ * @tparam HasGeneric : whether some states need the generic path.
+ * @tparam IndexType : type of the state indices.
+ * @tparam N : number of states.
+ * @tparam OnGeneric : callback type, invoked with a position in indices.
+ * @param[in,out] indices : state indices.
+ * @param[in] count : number of indices.
+ * @param[in] next : next state index for every state.
+ * @param[in] generic : whether each state needs the generic path.
+ * @param[in] onGeneric : generic path callback.
+ */
+template <bool HasGeneric, typename IndexType, std::size_t N, typename OnGeneric>
+void remap_indices(IndexType* indices, std::size_t count, const std::array<IndexType, N>& next,
+                   const std::array<bool, N>& generic, OnGeneric&& onGeneric)
+{
+	std::size_t i = 0;
+
+#if defined(__AVX2__) || defined(__SSSE3__) || (defined(__ARM_NEON) && defined(__aarch64__))
+	if constexpr (sizeof(IndexType) == 1 && N <= 16) {
+		alignas(16) std::uint8_t table[16] = {};
+		alignas(16) std::uint8_t flags[16] = {};
+		for (std::size_t s = 0; s < N; ++s) {
+			table[s] = static_cast<std::uint8_t>(next[s]);
+			flags[s] = generic[s] ? 0xff : 0x00;
+		}
+		auto* bytes = reinterpret_cast<std::uint8_t*>(indices);
+
+#if defined(__AVX2__)
+		const __m256i table256 = _mm256_broadcastsi128_si256(_mm_load_si128(reinterpret_cast<const __m128i*>(table)));
+		const __m256i flags256 = _mm256_broadcastsi128_si256(_mm_load_si128(reinterpret_cast<const __m128i*>(flags)));
+		for (; i + 32 <= count; i += 32) {
+			const __m256i current = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(bytes + i));
+			_mm256_storeu_si256(reinterpret_cast<__m256i*>(bytes + i), _mm256_shuffle_epi8(table256, current));
+			if constexpr (HasGeneric) {
+				const auto mask = static_cast<std::uint32_t>(_mm256_movemask_epi8(_mm256_shuffle_epi8(flags256, current)));
+				for_each_set_bit(mask, i, onGeneric);
+			}
+		}
+#endif
+#if defined(__SSSE3__)
+		const __m128i table128 = _mm_load_si128(reinterpret_cast<const __m128i*>(table));
+		const __m128i flags128 = _mm_load_si128(reinterpret_cast<const __m128i*>(flags));
+		for (; i + 16 <= count; i += 16) {
+			const __m128i current = _mm_loadu_si128(reinterpret_cast<const __m128i*>(bytes + i));
+			_mm_storeu_si128(reinterpret_cast<__m128i*>(bytes + i), _mm_shuffle_epi8(table128, current));
+			if constexpr (HasGeneric) {
+				const auto mask = static_cast<std::uint32_t>(_mm_movemask_epi8(_mm_shuffle_epi8(flags128, current)));
+				for_each_set_bit(mask, i, onGeneric);
+			}
+		}
+#elif defined(__ARM_NEON) && defined(__aarch64__)
+		const uint8x16_t table128 = vld1q_u8(table);
+		const uint8x16_t flags128 = vld1q_u8(flags);
+		for (; i + 16 <= count; i += 16) {
+			const uint8x16_t current = vld1q_u8(bytes + i);
+			vst1q_u8(bytes + i, vqtbl1q_u8(table128, current));
+			if constexpr (HasGeneric) {
+				const uint8x16_t lanes = vqtbl1q_u8(flags128, current);
+				if (vmaxvq_u8(lanes) != 0) {
+					alignas(16) std::uint8_t laneFlags[16];
+					vst1q_u8(laneFlags, lanes);
+					for (std::size_t lane = 0; lane < 16; ++lane) {
+						if (laneFlags[lane] != 0) {
+							onGeneric(i + lane);
+						}
+					}
+				}
+			}
+		}
+#endif
+	}
+#endif
+
+	for (; i < count; ++i) {
+		const auto current = indices[i];
+		indices[i] = next[current];
+		if constexpr (HasGeneric) {
+			if (generic[current]) {
+				onGeneric(i);
+			}
+		}
+	}
+}
+
+}  // End of namespace fsm
@@ -0,0 +1,118 @@
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+#include <memory>
+#include <utility>
+
+namespace fsm {
+
+/**
+ * @brief Bounded lock-free multi-producer single-consumer ring.
+ * @details Every cell carries a sequence number telling producers and the consumer whether it
+ * is free or filled (D. Vyukov's bounded queue). Producers claim a cell with one CAS on the
+ * tail and never wait on the consumer: when the ring is full tryPush fails immediately. The
+ * buffer is allocated once, at construction.
+ * @tparam T : element type, must be default constructible and move assignable.
+ */
+template <typename T>
+class MpscRing {
+public:
+    /**
+     * @param[in] capacity : number of cells, rounded up to a power of two.
+     */
+    explicit MpscRing(std::size_t capacity) : mask(roundUp(capacity) - 1), cells(new Cell[mask + 1]) {
+        for (std::size_t i = 0; i <= mask; ++i) {
+            cells[i].sequence.store(i, std::memory_order_relaxed);
+        }
+    }
+
+    MpscRing(const MpscRing&) = delete;
+    MpscRing& operator=(const MpscRing&) = delete;
+
+    std::size_t capacity() const noexcept {
+        return mask + 1;
+    }
+
+    /**
+     * @brief Enqueue a value, from any thread.
+     * @return false when the ring is full.
+     */
+    template <typename U>
+    bool tryPush(U&& value) {
+        std::size_t position = tail.load(std::memory_order_relaxed);
+        for (;;) {
+            Cell& cell = cells[position & mask];
+            const std::size_t sequence = cell.sequence.load(std::memory_order_acquire);
+            const auto difference = static_cast<std::ptrdiff_t>(sequence - position);
+            if (difference == 0) {
+                if (tail.compare_exchange_weak(position, position + 1, std::memory_order_relaxed)) {
+                    cell.value = std::forward<U>(value);
+                    cell.sequence.store(position + 1, std::memory_order_release);
+                    return true;
+                }
+            } else if (difference < 0) {
+                return false;
+            } else {
+                position = tail.load(std::memory_order_relaxed);
+            }
+        }
+    }
+
+    /**
+     * @brief Dequeue one value, from the consumer thread only.
+     * @return false when the ring is empty.
+     */
+    bool tryPop(T& value) {
+        const std::size_t position = head.load(std::memory_order_relaxed);
+        Cell& cell = cells[position & mask];
+        if (cell.sequence.load(std::memory_order_acquire) != position + 1) {
+            return false;
+        }
+        value = std::move(cell.value);
+        cell.sequence.store(position + mask + 1, std::memory_order_release);
+        head.store(position + 1, std::memory_order_relaxed);
+        return true;
+    }
+
+    /**
+     * @brief Dequeue up to count values into out, from the consumer thread only.
+     * @return Number of values dequeued.
+     */
+    std::size_t popBatch(T* out, std::size_t count) {
+        std::size_t popped = 0;
+        while (popped < count && tryPop(out[popped])) {
+            ++popped;
+        }
+        return popped;
+    }
+
+    /**
+     * @brief Whether the ring looked empty at the time of the call.
+     */
+    bool empty() const {
+        const std::size_t position = head.load(std::memory_order_relaxed);
+        return cells[position & mask].sequence.load(std::memory_order_acquire) != position + 1;
+    }
+
+private:
+    struct Cell {
+        std::atomic<std::size_t> sequence;
+        T value;
+    };
+
+    static std::size_t roundUp(std::size_t capacity) {
+        std::size_t rounded = 2;
+        while (rounded < capacity) {
+            rounded <<= 1;
+        }
+        return rounded;
+    }
+
+    const std::size_t mask;
+    std::unique_ptr<Cell[]> cells;
+    alignas(64) std::atomic<std::size_t> tail{0};
+    alignas(64) std::atomic<std::size_t> head{0};
+};
+
+}  // End of namespace fsm
@@ -0,0 +1,94 @@
+#pragma once
+
+#include <array>
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <type_traits>
+
+namespace fsm {
+
+/**
+ * @brief Latest value of a trivially copyable T, written by any thread and read without locks.
+ * @details A sequence number, odd while a write is in progress, guards the value, held in
+ * relaxed atomic words so that concurrent reads and writes stay well defined. Writers never
+ * wait: a writer finding another one in progress gives up, its value being superseded by the
+ * one being written. Readers retry until they copied the value between two writes.
+ * @tparam T : stored type, trivially copyable and default constructible.
+ */
+template <typename T>
+class SeqlockCell {
+    static_assert(std::is_trivially_copyable_v<T> && std::is_default_constructible_v<T>,
+                  "seqlock values are copied word by word");
+
+public:
+    /**
+     * @brief Store value, from any thread.
+     * @return false when another writer was storing: value is then dropped as superseded.
+     */
+    bool tryStore(const T& value) noexcept {
+        std::uint64_t current = sequence.load(std::memory_order_relaxed);
+        do {
+            if (current & 1) {
+                return false;
+            }
+        } while (!sequence.compare_exchange_weak(current, current + 1, std::memory_order_relaxed));
+        std::atomic_thread_fence(std::memory_order_release);
+        std::array<std::uint64_t, word_count> buffer{};
+        std::memcpy(buffer.data(), &value, sizeof(T));
+        for (std::size_t i = 0; i < word_count; ++i) {
+            words[i].store(buffer[i], std::memory_order_relaxed);
+        }
+        sequence.store(current + 2, std::memory_order_release);
+        return true;
+    }
+
+    /**
+     * @brief Copy the value into out unless a write is in progress or happens meanwhile.
+     * @param[out] version : version of the copied value, 0 before the first store.
+     */
+    bool tryLoad(T& out, std::uint64_t& version) const noexcept {
+        const std::uint64_t before = sequence.load(std::memory_order_acquire);
+        if (before & 1) {
+            return false;
+        }
+        std::array<std::uint64_t, word_count> buffer;
+        for (std::size_t i = 0; i < word_count; ++i) {
+            buffer[i] = words[i].load(std::memory_order_relaxed);
+        }
+        std::atomic_thread_fence(std::memory_order_acquire);
+        if (sequence.load(std::memory_order_relaxed) != before) {
+            return false;
+        }
+        std::memcpy(&out, buffer.data(), sizeof(T));
+        version = before / 2;
+        return true;
+    }
+
+    /**
+     * @brief Copy the value into out, retrying while it is written.
+     * @return Version of the copied value.
+     */
+    std::uint64_t load(T& out) const noexcept {
+        std::uint64_t version = 0;
+        while (!tryLoad(out, version)) {
+        }
+        return version;
+    }
+
+    /**
+     * @brief Number of completed stores.
+     */
+    std::uint64_t version() const noexcept {
+        return sequence.load(std::memory_order_acquire) / 2;
+    }
+
+private:
+    static constexpr std::size_t word_count = (sizeof(T) + sizeof(std::uint64_t) - 1) / sizeof(std::uint64_t);
+
+    std::atomic<std::uint64_t> sequence{0};
+    std::array<std::atomic<std::uint64_t>, word_count> words{};
+};
+
+}  // End of namespace fsm
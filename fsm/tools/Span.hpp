@@ -0,0 +1,127 @@
+#pragma once
+
+#include <cstddef>
+
+#if __cplusplus >= 202002L && __has_include(<span>)
+#include <span>
+#else
+#include <array>
+#include <type_traits>
+#include <vector>
+#endif
+
+namespace fsm {
+
+#if __cplusplus >= 202002L && __has_include(<span>)
+
+template <typename T>
+using span = std::span<T>;
+
+#else
+
+/**
+ * @brief Minimal stand-in for C++20 std::span (dynamic extent only).
+ * @tparam T : element type, const-qualified for read-only views.
+ */
+template <typename T>
+class span {
+public:
+    using element_type = T;
+    using value_type = std::remove_cv_t<T>;
+    using size_type = std::size_t;
+    using pointer = T*;
+    using reference = T&;
+    using iterator = T*;
+
+    constexpr span() noexcept = default;
+
+    constexpr span(T* data, size_type size) noexcept : ptr(data), count(size) {
+    }
+
+    template <std::size_t N>
+    constexpr span(T (&array)[N]) noexcept : ptr(array), count(N) {
+    }
+
+    template <typename U, std::size_t N, typename = std::enable_if_t<std::is_convertible_v<U (*)[], T (*)[]>>>
+    constexpr span(std::array<U, N>& array) noexcept : ptr(array.data()), count(N) {
+    }
+
+    template <typename U, std::size_t N, typename = std::enable_if_t<std::is_convertible_v<const U (*)[], T (*)[]>>>
+    constexpr span(const std::array<U, N>& array) noexcept : ptr(array.data()), count(N) {
+    }
+
+    template <typename U, typename A, typename = std::enable_if_t<std::is_convertible_v<U (*)[], T (*)[]>>>
+    span(std::vector<U, A>& vector) noexcept : ptr(vector.data()), count(vector.size()) {
+    }
+
+    template <typename U, typename A, typename = std::enable_if_t<std::is_convertible_v<const U (*)[], T (*)[]>>>
+    span(const std::vector<U, A>& vector) noexcept : ptr(vector.data()), count(vector.size()) {
+    }
+
+    template <typename U, typename = std::enable_if_t<std::is_convertible_v<U (*)[], T (*)[]>>>
+    constexpr span(const span<U>& other) noexcept : ptr(other.data()), count(other.size()) {
+    }
+
+    constexpr pointer data() const noexcept {
+        return ptr;
+    }
+
+    constexpr size_type size() const noexcept {
+        return count;
+    }
+
+    constexpr size_type size_bytes() const noexcept {
+        return count * sizeof(T);
+    }
+
+    constexpr bool empty() const noexcept {
+        return count == 0;
+    }
+
+    constexpr iterator begin() const noexcept {
+        return ptr;
+    }
+
+    constexpr iterator end() const noexcept {
+        return ptr + count;
+    }
+
+    constexpr reference operator[](size_type i) const noexcept {
+        return ptr[i];
+    }
+
+    constexpr span first(size_type n) const noexcept {
+        return {ptr, n};
+    }
+
+    constexpr span subspan(size_type offset) const noexcept {
+        return {ptr + offset, count - offset};
+    }
+
+    constexpr span subspan(size_type offset, size_type n) const noexcept {
+        return {ptr + offset, n};
+    }
+
+private:
+    T* ptr = nullptr;
+    size_type count = 0;
+};
+
+template <typename T, std::size_t N>
+span(T (&)[N]) -> span<T>;
+
+template <typename T, std::size_t N>
+span(std::array<T, N>&) -> span<T>;
+
+template <typename T, std::size_t N>
+span(const std::array<T, N>&) -> span<const T>;
+
+template <typename T, typename A>
+span(std::vector<T, A>&) -> span<T>;
+
+template <typename T, typename A>
+span(const std::vector<T, A>&) -> span<const T>;
+
+#endif
+
+}  // End of namespace fsm
@@ -0,0 +1,19 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <limits>
+#include <type_traits>
+
+namespace fsm {
+
+/**
+ * @brief Smallest unsigned integer type able to index Count states.
+ * @tparam Count : number of states.
+ */
+template <std::size_t Count>
+using state_index_t = std::conditional_t<(Count <= std::numeric_limits<std::uint8_t>::max() + std::size_t{1}),
+                                         std::uint8_t,
+                                         std::uint16_t>;
+
+}  // End of namespace fsm
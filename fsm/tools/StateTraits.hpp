@@ -0,0 +1,197 @@
+#pragma once
+
+#include <type_traits>
+#include <utility>
+
+#include "../actions/Nothing.hpp"
+
+namespace fsm {
+
+template <typename TargetState>
+class TransitionTo;
+
+/**
+ * @brief Action type returned by State when it handles Event.
+ */
+template <typename State, typename Event>
+using action_t = decltype(std::declval<const State&>().handle(std::declval<const Event&>()));
+
+/**
+ * @brief Whether State reacts to Event, i.e. its handler returns anything but Nothing.
+ * @details Decided on the handler's return type: a Maybe, OneOf or If counts as reacting even
+ * when it may hold Nothing at runtime.
+ */
+template <typename State, typename Event>
+constexpr bool handles_v = !std::is_same_v<action_t<State, Event>, Nothing>;
+
+/**
+ * @brief Whether no state of Machine reacts to Event, so that handling it has no effect.
+ * @details Machine is any type exposing a static constexpr reacts_to<Event>() (BasicStateMachine,
+ * MachinePool, Nested, Parallel).
+ */
+template <typename Machine, typename Event>
+constexpr bool is_noop_v = !Machine::template reacts_to<Event>();
+
+/**
+ * @brief Whether State defines onEnter for Event.
+ */
+template <typename State, typename Event, typename = void>
+struct has_on_enter : std::false_type {
+};
+
+template <typename State, typename Event>
+struct has_on_enter<State, Event, std::void_t<decltype(std::declval<State&>().onEnter(std::declval<const Event&>()))>>
+    : std::true_type {
+};
+
+template <typename State, typename Event>
+constexpr bool has_on_enter_v = has_on_enter<State, Event>::value;
+
+/**
+ * @brief Whether State defines onLeave for Event.
+ */
+template <typename State, typename Event, typename = void>
+struct has_on_leave : std::false_type {
+};
+
+template <typename State, typename Event>
+struct has_on_leave<State, Event, std::void_t<decltype(std::declval<State&>().onLeave(std::declval<const Event&>()))>>
+    : std::true_type {
+};
+
+template <typename State, typename Event>
+constexpr bool has_on_leave_v = has_on_leave<State, Event>::value;
+
+/**
+ * @brief Whether State defines onEnter for Event taking a Poster as second argument.
+ */
+template <typename State, typename Event, typename Poster, typename = void>
+struct has_posting_on_enter : std::false_type {
+};
+
+template <typename State, typename Event, typename Poster>
+struct has_posting_on_enter<State, Event, Poster,
+                            std::void_t<decltype(std::declval<State&>().onEnter(std::declval<const Event&>(),
+                                                                                std::declval<Poster&>()))>>
+    : std::true_type {
+};
+
+template <typename State, typename Event, typename Poster>
+constexpr bool has_posting_on_enter_v = has_posting_on_enter<State, Event, Poster>::value;
+
+/**
+ * @brief Whether State defines onLeave for Event taking a Poster as second argument.
+ */
+template <typename State, typename Event, typename Poster, typename = void>
+struct has_posting_on_leave : std::false_type {
+};
+
+template <typename State, typename Event, typename Poster>
+struct has_posting_on_leave<State, Event, Poster,
+                            std::void_t<decltype(std::declval<State&>().onLeave(std::declval<const Event&>(),
+                                                                                std::declval<Poster&>()))>>
+    : std::true_type {
+};
+
+template <typename State, typename Event, typename Poster>
+constexpr bool has_posting_on_leave_v = has_posting_on_leave<State, Event, Poster>::value;
+
+/**
+ * @brief Whether T, the result of an onEnter hook, is a coroutine the machine has to wait for.
+ */
+template <typename T, typename = void>
+struct suspends_machine : std::false_type {
+};
+
+template <typename T>
+struct suspends_machine<T, std::enable_if_t<T::suspends_machine>> : std::true_type {
+};
+
+template <typename T>
+constexpr bool suspends_machine_v = suspends_machine<T>::value;
+
+/**
+ * @brief Whether Machine can wait for Task, the coroutine of an onEnter hook (see fsm::AsyncMachine).
+ */
+template <typename Machine, typename Task, typename = void>
+struct has_suspend_on : std::false_type {
+};
+
+template <typename Machine, typename Task>
+struct has_suspend_on<Machine, Task, std::void_t<decltype(std::declval<Machine&>().suspendOn(std::declval<Task>()))>>
+    : std::true_type {
+};
+
+template <typename Machine, typename Task>
+constexpr bool has_suspend_on_v = has_suspend_on<Machine, Task>::value;
+
+/**
+ * @brief Whether State has an After handler, i.e. a timeout_duration.
+ */
+template <typename State, typename = void>
+struct has_timeout : std::false_type {
+};
+
+template <typename State>
+struct has_timeout<State, std::void_t<typename State::timeout_duration>> : std::true_type {
+};
+
+template <typename State>
+constexpr bool has_timeout_v = has_timeout<State>::value;
+
+/**
+ * @brief Target state of a TransitionTo action, void for any other action.
+ */
+template <typename Action>
+struct transition_target {
+    using type = void;
+};
+
+template <typename TargetState>
+struct transition_target<TransitionTo<TargetState>> {
+    using type = TargetState;
+};
+
+template <typename Action>
+using transition_target_t = typename transition_target<Action>::type;
+
+/**
+ * @brief Whether the reaction of State to Event is a pure function of (state, event type).
+ * @details True when State carries no data and its handler returns either Nothing, or a
+ * TransitionTo whose source and target define no onLeave/onEnter hook for Event and no timeout. Such
+ * reactions can be applied by rewriting the state index alone, without calling the handler.
+ */
+template <typename State, typename Event>
+constexpr bool is_table_driven() {
+    if constexpr (!std::is_empty_v<State>) {
+        return false;
+    } else {
+        using action = action_t<State, Event>;
+        using target = transition_target_t<action>;
+        if constexpr (std::is_same_v<action, Nothing>) {
+            return true;
+        } else if constexpr (std::is_void_v<target>) {
+            return false;
+        } else {
+            return !has_on_leave_v<State, Event> && !has_on_enter_v<target, Event> && !has_timeout_v<State> &&
+                   !has_timeout_v<target>;
+        }
+    }
+}
+
+template <typename State, typename Event>
+constexpr bool is_table_driven_v = is_table_driven<State, Event>();
+
+/**
+ * @brief Whether executing Action is usable from hard real-time code.
+ * @details The action has to be trivially copyable and trivially destructible (hence owns no
+ * resource to release), and its execute for the given machine, state and event has to be
+ * noexcept. Meant to be checked with static_assert.
+ */
+template <typename Action, typename Machine, typename State, typename Event>
+constexpr bool is_realtime_action_v =
+    std::is_trivially_copyable_v<Action> && std::is_trivially_destructible_v<Action> &&
+    noexcept(std::declval<Action&>().execute(std::declval<Machine&>(), std::declval<State&>(),
+                                             std::declval<const Event&>()));
+
+}  // End of namespace fsm
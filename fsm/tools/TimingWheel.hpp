@@ -0,0 +1,305 @@
+#pragma once
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <limits>
+#include <vector>
+
+namespace fsm {
+
+/**
+ * @brief Hierarchical timing wheel holding at most one timer per dense key.
+ * @details Keys are small integers, typically the ids of a MachinePool, and the timer of every
+ * key is an intrusive node preallocated by resize(), so arming and cancelling never allocate and
+ * take O(1). The wheel has level_count levels of slot_count slots; level L holds the timers
+ * expiring between slot_count^L and slot_count^(L+1) ticks from now, and its slots are cascaded
+ * one level down as time reaches them. Timers further away than the top level are parked in it
+ * and cascaded again. Time is an unsigned tick count only ever moving forward, such as
+ * milliseconds of a steady clock.
+ */
+class TimingWheel {
+public:
+    using key_type = std::uint32_t;
+    using tick_type = std::uint64_t;
+
+    static constexpr std::size_t slot_bits = 6;
+    static constexpr std::size_t slot_count = std::size_t{1} << slot_bits;
+    static constexpr std::size_t level_count = 5;
+
+    explicit TimingWheel(tick_type now = 0) noexcept : current(now + 1) {
+        for (auto& level : slots) {
+            level.fill(none);
+        }
+    }
+
+    /**
+     * @brief Make room for the timers of keys [0, count); keys past count are dropped.
+     */
+    void resize(std::size_t count) {
+        for (std::size_t key = count; key < nodes.size(); ++key) {
+            cancel(static_cast<key_type>(key));
+        }
+        nodes.resize(count);
+        expired.reserve(count);
+    }
+
+    void reserve(std::size_t count) {
+        nodes.reserve(count);
+        expired.reserve(count);
+    }
+
+    /**
+     * @brief Cancel every timer and drop every key.
+     */
+    void clear() noexcept {
+        for (auto& level : slots) {
+            level.fill(none);
+        }
+        occupied.fill(0);
+        nodes.clear();
+        armedCount = 0;
+    }
+
+    std::size_t size() const noexcept {
+        return nodes.size();
+    }
+
+    /**
+     * @brief Number of armed timers.
+     */
+    std::size_t pending() const noexcept {
+        return armedCount;
+    }
+
+    bool armed(key_type key) const noexcept {
+        return nodes[key].level != unarmed;
+    }
+
+    /**
+     * @brief Last tick passed to advance().
+     */
+    tick_type now() const noexcept {
+        return current - 1;
+    }
+
+    /**
+     * @brief Move the time to now, backwards or forwards, without firing anything: every armed
+     * timer keeps the delay it had left, e.g. when the time the wheel was started at was not
+     * known when the timers were armed.
+     */
+    void restart(tick_type now) noexcept {
+        const tick_type before = this->now();
+        current = now + 1;
+        for (auto& level : slots) {
+            level.fill(none);
+        }
+        occupied.fill(0);
+        for (key_type key = 0; key < nodes.size(); ++key) {
+            Node& node = nodes[key];
+            if (node.level != unarmed) {
+                node.deadline = now + (node.deadline > before ? node.deadline - before : 0);
+                link(key);
+            }
+        }
+    }
+
+    /**
+     * @brief Arm the timer of key to fire at the given tick, replacing the pending one if any.
+     * @details A deadline not after now() fires on the next advance().
+     */
+    void arm(key_type key, tick_type deadline) noexcept {
+        cancel(key);
+        nodes[key].deadline = deadline;
+        link(key);
+        ++armedCount;
+    }
+
+    /**
+     * @brief Arm the timer of key to fire delay ticks after now().
+     */
+    void armAfter(key_type key, tick_type delay) noexcept {
+        arm(key, now() + delay);
+    }
+
+    void cancel(key_type key) noexcept {
+        Node& node = nodes[key];
+        if (node.level == unarmed) {
+            return;
+        }
+        unlink(key);
+        node.level = unarmed;
+        --armedCount;
+    }
+
+    /**
+     * @brief Fire, in deadline order, the timers due at or before tick now.
+     * @details The timers due at one tick are disarmed first, then passed to sink(key) in one
+     * batch, so that sink may arm or cancel any timer, including the one firing; now() is then
+     * the tick being fired.
+     * @return Number of timers fired.
+     */
+    template <typename Sink>
+    std::size_t advance(tick_type now, Sink&& sink) {
+        std::size_t fired = 0;
+        while (current <= now) {
+            if (armedCount == 0) {
+                current = now + 1;
+                break;
+            }
+            if ((current & slot_mask) == 0) {
+                cascade();
+            }
+            const std::size_t slot = current & slot_mask;
+            ++current;
+            if (occupied[0] & (std::uint64_t{1} << slot)) {
+                fired += fire(slot, sink);
+            }
+            current = nextTick(now);
+        }
+        return fired;
+    }
+
+private:
+    static constexpr tick_type slot_mask = slot_count - 1;
+    static constexpr key_type none = std::numeric_limits<key_type>::max();
+    static constexpr std::uint8_t unarmed = 0xff;
+
+    struct Node {
+        tick_type deadline = 0;
+        key_type prev = none;
+        key_type next = none;
+        std::uint8_t level = unarmed;
+        std::uint8_t slot = 0;
+    };
+
+    static std::size_t lowestBit(std::uint64_t bits) noexcept {
+#if defined(__GNUC__) || defined(__clang__)
+        return static_cast<std::size_t>(__builtin_ctzll(bits));
+#else
+        std::size_t bit = 0;
+        while ((bits & 1) == 0) {
+            bits >>= 1;
+            ++bit;
+        }
+        return bit;
+#endif
+    }
+
+    /**
+     * @brief First tick from current with work to do: an occupied slot of level 0 to fire, or an
+     * occupied slot of a higher level to cascade; whole revolutions of empty slots are skipped.
+     */
+    tick_type nextTick(tick_type now) const noexcept {
+        tick_type next = now + 1;
+        for (std::size_t level = 0; level < level_count; ++level) {
+            if (occupied[level] == 0) {
+                continue;
+            }
+            const std::size_t shift = slot_bits * level;
+            const tick_type revolution = tick_type{1} << (shift + slot_bits);
+            const tick_type base = current & ~(revolution - 1);
+            const tick_type first = (current - base + (tick_type{1} << shift) - 1) >> shift;
+            const std::uint64_t ahead = first < slot_count ? occupied[level] >> first << first : 0;
+            const tick_type at = ahead ? base + (tick_type{lowestBit(ahead)} << shift)
+                                       : base + revolution + (tick_type{lowestBit(occupied[level])} << shift);
+            next = at < next ? at : next;
+        }
+        return next;
+    }
+
+    /**
+     * @brief Put the node of key in the slot matching its deadline, relative to current.
+     */
+    void link(key_type key) noexcept {
+        Node& node = nodes[key];
+        const tick_type deadline = node.deadline < current ? current : node.deadline;
+        const tick_type delta = deadline - current;
+        std::size_t level = 0;
+        while (level + 1 < level_count && delta >> (slot_bits * (level + 1)) != 0) {
+            ++level;
+        }
+        tick_type position = deadline;
+        if (level + 1 == level_count && delta >> (slot_bits * level_count) != 0) {
+            // Too far away: park it in the last top-level slot reached before its deadline.
+            position = current + (tick_type{1} << (slot_bits * level_count)) - 1;
+        }
+        const std::size_t slot = (position >> (slot_bits * level)) & slot_mask;
+        node.level = static_cast<std::uint8_t>(level);
+        node.slot = static_cast<std::uint8_t>(slot);
+        node.prev = none;
+        node.next = slots[level][slot];
+        if (node.next != none) {
+            nodes[node.next].prev = key;
+        }
+        slots[level][slot] = key;
+        occupied[level] |= std::uint64_t{1} << slot;
+    }
+
+    void unlink(key_type key) noexcept {
+        Node& node = nodes[key];
+        if (node.prev != none) {
+            nodes[node.prev].next = node.next;
+        } else {
+            slots[node.level][node.slot] = node.next;
+            if (node.next == none) {
+                occupied[node.level] &= ~(std::uint64_t{1} << node.slot);
+            }
+        }
+        if (node.next != none) {
+            nodes[node.next].prev = node.prev;
+        }
+    }
+
+    /**
+     * @brief Detach the list of a slot.
+     * @return First key of the list.
+     */
+    key_type take(std::size_t level, std::size_t slot) noexcept {
+        const key_type head = slots[level][slot];
+        slots[level][slot] = none;
+        occupied[level] &= ~(std::uint64_t{1} << slot);
+        return head;
+    }
+
+    /**
+     * @brief Move the timers of the slots current reaches one level down, from the top level.
+     */
+    void cascade() noexcept {
+        std::size_t top = 1;
+        while (top + 1 < level_count && ((current >> (slot_bits * top)) & slot_mask) == 0) {
+            ++top;
+        }
+        for (std::size_t level = top; level > 0; --level) {
+            key_type key = take(level, (current >> (slot_bits * level)) & slot_mask);
+            while (key != none) {
+                const key_type next = nodes[key].next;
+                link(key);
+                key = next;
+            }
+        }
+    }
+
+    template <typename Sink>
+    std::size_t fire(std::size_t slot, Sink& sink) {
+        expired.clear();
+        for (key_type key = take(0, slot); key != none; key = nodes[key].next) {
+            nodes[key].level = unarmed;
+            expired.push_back(key);
+        }
+        armedCount -= expired.size();
+        for (const key_type key : expired) {
+            sink(key);
+        }
+        return expired.size();
+    }
+
+    tick_type current;
+    std::size_t armedCount = 0;
+    std::array<std::array<key_type, slot_count>, level_count> slots;
+    std::array<std::uint64_t, level_count> occupied{};
+    std::vector<Node> nodes;
+    std::vector<key_type> expired;
+};
+
+}  // End of namespace fsm
@@ -0,0 +1,193 @@
+#pragma once
+
+#include <array>
+#include <cstddef>
+#include <utility>
+
+#include "../actions/If.hpp"
+#include "../actions/Maybe.hpp"
+#include "../actions/Nothing.hpp"
+#include "../actions/OneOf.hpp"
+#include "../actions/TransitionTo.hpp"
+#include "StateTraits.hpp"
+#include "TypeIndex.hpp"
+
+namespace fsm {
+
+template <class Policy, class... States>
+class BasicStateMachine;
+
+template <class... States>
+class MachinePool;
+
+/**
+ * @brief Transition of the graph: Event number event, in state from, may lead to state to.
+ * @details States are numbered as in the machine (see state_id), events as in the list passed
+ * to transition_graph. to is the number of states when the target cannot be told from the type
+ * of the action, or is not a state of the machine (a transition out of a Nested state).
+ */
+struct transition_edge {
+    std::size_t from;
+    std::size_t event;
+    std::size_t to;
+};
+
+template <typename... Targets>
+struct target_list {
+};
+
+template <typename... Lists>
+struct concat_targets;
+
+template <>
+struct concat_targets<> {
+    using type = target_list<>;
+};
+
+template <typename... Ts>
+struct concat_targets<target_list<Ts...>> {
+    using type = target_list<Ts...>;
+};
+
+template <typename... Ts, typename... Us, typename... Lists>
+struct concat_targets<target_list<Ts...>, target_list<Us...>, Lists...>
+    : concat_targets<target_list<Ts..., Us...>, Lists...> {
+};
+
+/**
+ * @brief States an action may transition to, as a target_list; void stands for a target
+ * decided by an action other than Nothing, TransitionTo, Maybe, OneOf and If.
+ */
+template <typename Action>
+struct transition_targets {
+    using type = target_list<void>;
+};
+
+template <>
+struct transition_targets<Nothing> {
+    using type = target_list<>;
+};
+
+template <typename TargetState>
+struct transition_targets<TransitionTo<TargetState>> {
+    using type = target_list<TargetState>;
+};
+
+template <typename... Actions>
+struct transition_targets<OneOf<Actions...>> : concat_targets<typename transition_targets<Actions>::type...> {
+};
+
+template <typename Action>
+struct transition_targets<Maybe<Action>> : transition_targets<Action> {
+};
+
+template <auto Guard, typename Then, typename Else>
+struct transition_targets<If<Guard, Then, Else>>
+    : concat_targets<typename transition_targets<Then>::type, typename transition_targets<Else>::type> {
+};
+
+template <typename Action>
+using transition_targets_t = typename transition_targets<Action>::type;
+
+template <typename Machine, typename... Events>
+struct transition_graph_of;
+
+/**
+ * @brief Transition graph of a machine of States, computed from the handler types alone.
+ */
+template <typename... States>
+struct transition_graph_states {
+    template <typename... Events>
+    struct over {
+        static constexpr std::size_t state_count = sizeof...(States);
+
+        template <typename State, typename Event>
+        static constexpr std::size_t edgeCount() {
+            return edgeCount(transition_targets_t<action_t<State, Event>>{});
+        }
+
+        template <typename... Targets>
+        static constexpr std::size_t edgeCount(target_list<Targets...>) {
+            return sizeof...(Targets);
+        }
+
+        template <typename State>
+        static constexpr std::size_t stateEdgeCount() {
+            return (std::size_t{0} + ... + edgeCount<State, Events>());
+        }
+
+        static constexpr std::size_t edge_count = (std::size_t{0} + ... + stateEdgeCount<States>());
+
+        using edges_type = std::array<transition_edge, edge_count>;
+
+        template <typename State, std::size_t Event, typename... Targets>
+        static constexpr void addEdges(edges_type& edges, std::size_t& size, target_list<Targets...>) {
+            ((edges[size++] = transition_edge{type_index_v<State, States...>, Event, type_index_v<Targets, States...>}),
+             ...);
+        }
+
+        template <typename State, std::size_t... EventIdxs>
+        static constexpr void addStateEdges(edges_type& edges, std::size_t& size, std::index_sequence<EventIdxs...>) {
+            (addEdges<State, EventIdxs>(edges, size, transition_targets_t<action_t<State, Events>>{}), ...);
+        }
+
+        static constexpr edges_type edges() {
+            edges_type edges{};
+            std::size_t size = 0;
+            (addStateEdges<States>(edges, size, std::index_sequence_for<Events...>{}), ...);
+            return edges;
+        }
+    };
+};
+
+template <class Policy, class... States, typename... Events>
+struct transition_graph_of<BasicStateMachine<Policy, States...>, Events...>
+    : transition_graph_states<States...>::template over<Events...> {
+};
+
+template <class... States, typename... Events>
+struct transition_graph_of<MachinePool<States...>, Events...>
+    : transition_graph_states<States...>::template over<Events...> {
+};
+
+/**
+ * @brief Every transition Events may cause in Machine, a BasicStateMachine or a MachinePool, as
+ * a compile-time array of transition_edge, in state then event order.
+ * @details Only the types returned by the handlers are looked at: an If or a Maybe yields one
+ * edge per branch leading to a state, Nothing yields none.
+ * @code
+ * constexpr auto edges = fsm::transition_graph<Door, OpenEvent, CloseEvent, LockEvent, UnlockEvent>();
+ * @endcode
+ */
+template <class Machine, typename... Events>
+constexpr auto transition_graph() {
+    return transition_graph_of<Machine, Events...>::edges();
+}
+
+/**
+ * @brief States of Machine reachable from state from through sequences of Events, including
+ * from itself, indexed by state id. Edges with an unknown target are not followed.
+ * @code
+ * static_assert(fsm::reachable_states<Door, OpenEvent, CloseEvent>()[Door::state_id<OpenState>]);
+ * @endcode
+ */
+template <class Machine, typename... Events>
+constexpr auto reachable_states(std::size_t from = 0) {
+    using graph = transition_graph_of<Machine, Events...>;
+    constexpr auto edges = graph::edges();
+    std::array<bool, graph::state_count> reached{};
+    reached[from] = true;
+    bool grown = true;
+    while (grown) {
+        grown = false;
+        for (const transition_edge& edge : edges) {
+            if (reached[edge.from] && edge.to < graph::state_count && !reached[edge.to]) {
+                reached[edge.to] = true;
+                grown = true;
+            }
+        }
+    }
+    return reached;
+}
+
+}  // End of namespace fsm
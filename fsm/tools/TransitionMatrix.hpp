@@ -0,0 +1,66 @@
+#pragma once
+
+#include <array>
+#include <cstddef>
+
+#include "StateIndex.hpp"
+#include "StateTraits.hpp"
+#include "TypeIndex.hpp"
+
+namespace fsm {
+
+/**
+ * @struct uniform_transition_matrix
+ * @brief Compile-time row of the transition matrix for one event type.
+ * @details For every table-driven state (see is_table_driven), next[i] holds the index of the
+ * state reached from state i when Event arrives. Other states map to themselves and are
+ * flagged in generic, their reaction has to go through the regular handler.
+ * @tparam Event : event type.
+ * @tparam States : states of the machine.
+ */
+template <typename Event, typename... States>
+struct uniform_transition_matrix
+{
+	using index_type = state_index_t<sizeof...(States)>;
+	const static auto state_count = sizeof...(States);
+
+	/**
+	 * @brief Index of the state reached from State, or of State itself.
+	 * @tparam State : source state.
+	 * @tparam Ind : index of the source state.
+	 */
+	template <typename State, std::size_t Ind>
+	static constexpr index_type nextIndex()
+	{
+		if constexpr (is_table_driven_v<State, Event>) {
+			using target = transition_target_t<action_t<State, Event>>;
+			if constexpr (!std::is_void_v<target>) {
+				return static_cast<index_type>(type_index_v<target, States...>);
+			}
+		}
+		return static_cast<index_type>(Ind);
+	}
+
+	template <std::size_t... Idxs>
+	static constexpr std::array<index_type, state_count> makeNext(std::index_sequence<Idxs...>)
+	{
+		return {{nextIndex<States, Idxs>()...}};
+	}
+
+	/**
+	 * @brief Next state index for every state.
+	 */
+	constexpr static std::array<index_type, state_count> next = makeNext(std::index_sequence_for<States...>{});
+
+	/**
+	 * @brief Whether each state needs the generic handler path.
+	 */
+	constexpr static std::array<bool, state_count> generic = {{!is_table_driven_v<States, Event>...}};
+
+	/**
+	 * @brief Whether every state is table-driven for Event.
+	 */
+	constexpr static bool all_table_driven = (is_table_driven_v<States, Event> && ...);
+};
+
+}  // End of namespace fsm
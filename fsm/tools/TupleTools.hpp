@@ -32,7 +32,7 @@ struct tuple_runtime_access_table
 	 * @return Converted value.
 	 */
 	template <std::size_t Ind>
-	static return_type accessTemplateTuplele(tuple_type& t, converter_fun& func)
+	static constexpr return_type accessTemplateTuplele(tuple_type& t, converter_fun& func)
 	{
 		return func(std::get<Ind>(t));
 	}
@@ -59,7 +59,7 @@ struct tuple_runtime_access_table
  * @return Converted value.
  */
 template <typename ReturnType, typename TemplateTuple, typename ConverterFunction, std::size_t... Idxs>
-auto call_access_function(TemplateTuple& t, std::size_t i, ConverterFunction f, std::index_sequence<Idxs...>)
+constexpr auto call_access_function(TemplateTuple& t, std::size_t i, ConverterFunction f, std::index_sequence<Idxs...>)
 {
 	auto& table = tuple_runtime_access_table<TemplateTuple, ReturnType, ConverterFunction, Idxs...>::lookup_table;
 	auto* access_function = table[i];
@@ -120,7 +120,7 @@ using commonTemplateTuplele_access_t = typename commonTemplateTuplele_access<Tem
  * @return std::variant with pointer to the tuple.
  */
 template <typename TemplateTuple>
-auto runtime_get(TemplateTuple& t, std::size_t i)
+constexpr auto runtime_get(TemplateTuple& t, std::size_t i)
 {
 	return call_access_function<commonTemplateTuplele_access_t<TemplateTuple>>(t, i, [](auto& element) { return &element; },
 	                                                         std::make_index_sequence<std::tuple_size_v<TemplateTuple>>{});
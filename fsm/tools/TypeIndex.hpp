@@ -0,0 +1,28 @@
+#pragma once
+
+#include <cstddef>
+#include <type_traits>
+
+namespace fsm {
+
+/**
+ * @brief Position of T in the parameter pack Ts.
+ * @details Evaluated over a constexpr array instead of recursive instantiation.
+ * @tparam T : searched type.
+ * @tparam Ts : parameter pack.
+ * @return Index of the first occurrence of T, or sizeof...(Ts) when T is not in Ts.
+ */
+template <typename T, typename... Ts>
+constexpr std::size_t type_index() {
+    constexpr bool matches[] = {std::is_same_v<T, Ts>..., true};
+    std::size_t i = 0;
+    while (!matches[i]) {
+        ++i;
+    }
+    return i;
+}
+
+template <typename T, typename... Ts>
+constexpr std::size_t type_index_v = type_index<T, Ts...>();
+
+}  // End of namespace fsm
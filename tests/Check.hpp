@@ -0,0 +1,16 @@
+#pragma once
+
+#include <cstdio>
+#include <cstdlib>
+
+/**
+ * @brief Fail the test with the location of cond when it does not hold; unlike assert, also
+ * checked in release builds.
+ */
+#define FSM_CHECK(cond)                                                                  \
+    do {                                                                                 \
+        if (!(cond)) {                                                                   \
+            std::fprintf(stderr, "%s:%d: check failed: %s\n", __FILE__, __LINE__, #cond); \
+            std::exit(EXIT_FAILURE);                                                     \
+        }                                                                                \
+    } while (false)
@@ -0,0 +1,150 @@
+#include <fsm/AsyncMachine.hpp>
+
+#if FSM_HAS_COROUTINES
+
+#include <stdexcept>
+#include <vector>
+
+#include <fsm/StateMachine.hpp>
+#include <fsm/actions/ByDefault.hpp>
+#include <fsm/actions/Nothing.hpp>
+#include <fsm/actions/On.hpp>
+#include <fsm/actions/TransitionTo.hpp>
+#include <fsm/actions/Will.hpp>
+
+#include "Check.hpp"
+
+namespace {
+
+struct Io {
+    auto wait() {
+        struct awaiter {
+            bool await_ready() const noexcept {
+                return false;
+            }
+
+            void await_suspend(std::coroutine_handle<> handle) {
+                io.waiting.push_back(handle);
+            }
+
+            void await_resume() const noexcept {
+            }
+
+            Io& io;
+        };
+        return awaiter{*this};
+    }
+
+    void complete() {
+        auto resumed = std::move(waiting);
+        waiting.clear();
+        for (auto handle : resumed) {
+            handle.resume();
+        }
+    }
+
+    std::vector<std::coroutine_handle<>> waiting;
+};
+
+Io io;
+
+struct FailingOnce {
+    template <class F>
+    void execute(F&& f) {
+        if (failures > 0) {
+            --failures;
+            throw std::runtime_error("executor full");
+        }
+        f();
+    }
+
+    int failures = 1;
+};
+
+struct FetchEvent {
+};
+
+struct DoneEvent {
+};
+
+struct ResetEvent {
+};
+
+struct IdleState;
+struct FetchingState;
+struct ReadyState;
+
+struct IdleState : fsm::Will<fsm::ByDefault<fsm::Nothing>, fsm::On<FetchEvent, fsm::TransitionTo<FetchingState>>,
+                             fsm::On<DoneEvent, fsm::TransitionTo<ReadyState>>> {
+};
+
+struct FetchingState : fsm::Will<fsm::ByDefault<fsm::Nothing>, fsm::On<DoneEvent, fsm::TransitionTo<ReadyState>>> {
+    fsm::Task onEnter(const FetchEvent&) {
+        co_await io.wait();
+    }
+};
+
+struct ReadyState : fsm::Will<fsm::ByDefault<fsm::Nothing>, fsm::On<ResetEvent, fsm::TransitionTo<IdleState>>> {
+    fsm::Task onEnter(const DoneEvent&) {
+        co_return;
+    }
+};
+
+using Machine = fsm::AsyncMachine<fsm::StateMachine<IdleState, FetchingState, ReadyState>, FailingOnce, FetchEvent,
+                                  DoneEvent, ResetEvent>;
+
+constexpr std::size_t idle = 0;
+constexpr std::size_t ready = 2;
+
+void synchronousCompletionFailureIsRethrown() {
+    FailingOnce executor;
+    Machine machine(executor);
+    machine.handle(DoneEvent{});
+    FSM_CHECK(!machine.suspended());
+    FSM_CHECK(machine.machine().currentIndex() == ready);
+    bool threw = false;
+    try {
+        machine.handle(ResetEvent{});
+    } catch (const std::runtime_error&) {
+        threw = true;
+    }
+    FSM_CHECK(threw);
+    machine.handle(ResetEvent{});
+    FSM_CHECK(machine.machine().currentIndex() == idle);
+}
+
+void queuedEventsRunAfterTheFailure() {
+    FailingOnce executor;
+    Machine machine(executor);
+    machine.handle(FetchEvent{});
+    FSM_CHECK(machine.suspended());
+    machine.handle(DoneEvent{});
+    FSM_CHECK(machine.pending() == 1);
+    io.complete();
+    FSM_CHECK(!machine.suspended());
+    bool threw = false;
+    try {
+        machine.handle(ResetEvent{});
+    } catch (const std::runtime_error&) {
+        threw = true;
+    }
+    FSM_CHECK(threw);
+    FSM_CHECK(machine.pending() == 1);
+    machine.handle(ResetEvent{});
+    FSM_CHECK(machine.pending() == 0);
+    FSM_CHECK(machine.machine().currentIndex() == idle);
+}
+
+}  // namespace
+
+int main() {
+    synchronousCompletionFailureIsRethrown();
+    queuedEventsRunAfterTheFailure();
+}
+
+#else
+
+int main() {
+}
+
+#endif
@@ -0,0 +1,63 @@
+#include <thread>
+
+#include <fsm/StateMachine.hpp>
+#include <fsm/actions/ByDefault.hpp>
+#include <fsm/actions/Nothing.hpp>
+#include <fsm/actions/On.hpp>
+#include <fsm/actions/TransitionTo.hpp>
+#include <fsm/actions/Will.hpp>
+#include <fsm/observers/HistogramObserver.hpp>
+
+#include "Check.hpp"
+
+namespace {
+
+struct Flip {
+};
+
+struct Pong;
+
+struct Ping : fsm::Will<fsm::ByDefault<fsm::Nothing>, fsm::On<Flip, fsm::TransitionTo<Pong>>> {
+};
+
+struct Pong : fsm::Will<fsm::ByDefault<fsm::Nothing>, fsm::On<Flip, fsm::TransitionTo<Ping>>> {
+};
+
+using Histogram = fsm::HistogramObserver<2, Flip>;
+
+struct ProfiledPolicy : fsm::DefaultPolicy {
+    using Observer = Histogram;
+};
+
+using Machine = fsm::BasicStateMachine<ProfiledPolicy, Ping, Pong>;
+
+/**
+ * Only the threads which called prepare() are counted, each in its own Counters.
+ */
+void preparedThreadsAreCounted() {
+    std::thread unprofiled([] {
+        Machine machine;
+        machine.handle(Flip{});
+        FSM_CHECK(Histogram::local().dispatchCount(0, 0) == 0);
+        FSM_CHECK(Histogram::local().transitionCount(0, 1, 0) == 0);
+    });
+    unprofiled.join();
+
+    Histogram::prepare();
+    Machine machine;
+    machine.handle(Flip{});
+    machine.handle(Flip{});
+    machine.handle(Flip{});
+    const Histogram::Counters& counters = Histogram::local();
+    FSM_CHECK(counters.dispatchCount(0, 0) == 2 && counters.dispatchCount(1, 0) == 1);
+    FSM_CHECK(counters.transitionCount(0, 1, 0) == 2 && counters.transitionCount(1, 0, 0) == 1);
+    FSM_CHECK(counters.transitionCount(0, 0, 0) == 0);
+    Histogram::reset();
+    FSM_CHECK(Histogram::local().transitionCount(0, 1, 0) == 0);
+}
+
+}  // namespace
+
+int main() {
+    preparedThreadsAreCounted();
+}
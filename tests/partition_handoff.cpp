@@ -0,0 +1,124 @@
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <vector>
+
+#include <fsm/MachinePool.hpp>
+#include <fsm/Partition.hpp>
+#include <fsm/actions/After.hpp>
+#include <fsm/actions/ByDefault.hpp>
+#include <fsm/actions/Nothing.hpp>
+#include <fsm/actions/On.hpp>
+#include <fsm/actions/TransitionTo.hpp>
+#include <fsm/actions/Will.hpp>
+
+#include "Check.hpp"
+
+namespace {
+
+struct Arm {
+};
+
+struct Armed;
+
+struct Idle : fsm::Will<fsm::ByDefault<fsm::Nothing>, fsm::On<Arm, fsm::TransitionTo<Armed>>> {
+    explicit Idle(std::uint32_t limit) : limit(limit) {
+    }
+
+    std::uint32_t limit;
+};
+
+struct Armed : fsm::Will<fsm::ByDefault<fsm::Nothing>, fsm::After<fsm::timeout_seconds<30>, fsm::TransitionTo<Idle>>> {
+};
+
+using Pool = fsm::MachinePool<Idle, Armed>;
+using Node = fsm::PartitionNode<Pool, Arm>;
+
+constexpr std::size_t idle = 0;
+constexpr std::size_t armed = 1;
+
+/**
+ * Partition 1 of 8 machines in partitions of 4, moved from node 0 to node 1 with one Arm
+ * buffered for machine 5.
+ */
+std::vector<std::byte> movedBlock(Node& source, Node& target) {
+    source.beginHandoff(1);
+    target.expect(1);
+    FSM_CHECK(source.handle(5, Arm{}));
+    FSM_CHECK(source.machines().currentIndex(5) == idle);
+    std::vector<std::byte> block(source.blockSize(1));
+    FSM_CHECK(source.extract(1, fsm::span<std::byte>(block.data(), block.size())) == block.size());
+    return block;
+}
+
+/**
+ * A block whose pending event has an unknown type is rejected before touching the node; the
+ * intact block is then adopted, with the gap before it filled from the prototypes.
+ */
+void badEventsAreRejected() {
+    fsm::PartitionMap map(4);
+    map.addNode(0);
+    Pool first{Idle{7}, Armed{}};
+    Pool second{Idle{9}, Armed{}};
+    Node source{map, 0, first};
+    Node target{map, 1, second};
+    source.claim(8);
+    std::vector<std::byte> block = movedBlock(source, target);
+
+    fsm::partition_header header;
+    std::memcpy(&header, block.data(), sizeof(header));
+    const std::size_t record = block.size() - static_cast<std::size_t>(header.eventSize);
+    fsm::partition_event event;
+    std::memcpy(&event, block.data() + record, sizeof(event));
+    event.type = 3;
+    std::memcpy(block.data() + record, &event, sizeof(event));
+    const fsm::span<const std::byte> bytes{block.data(), block.size()};
+    FSM_CHECK(!target.adopt(bytes));
+    FSM_CHECK(second.size() == 0);
+    FSM_CHECK(!target.holds(1) && target.buffering(1));
+
+    event.type = 0;
+    std::memcpy(block.data() + record, &event, sizeof(event));
+    FSM_CHECK(target.adopt(bytes));
+    FSM_CHECK(target.holds(1) && second.size() == 8);
+    FSM_CHECK(second.currentIndex(5) == armed && second.timerArmed(5));
+    FSM_CHECK(second.currentIndex(0) == idle && second.state<Idle>(0).limit == 9);
+    FSM_CHECK(!second.timerArmed(0));
+    FSM_CHECK(second.state<Idle>(4).limit == 7);
+}
+
+/**
+ * Machines stop timing out in the source pool once their handoff begins, and time out in the
+ * target pool after adopt.
+ */
+void timersMoveWithThePartition() {
+    fsm::PartitionMap map(4);
+    map.addNode(0);
+    Pool first{Idle{7}, Armed{}};
+    Pool second{Idle{9}, Armed{}};
+    Node source{map, 0, first};
+    Node target{map, 1, second};
+    source.claim(8);
+    const auto now = std::chrono::steady_clock::now().time_since_epoch();
+    first.tick(now);
+    FSM_CHECK(source.handle(6, Arm{}));
+    FSM_CHECK(first.timerArmed(6));
+    const std::vector<std::byte> block = movedBlock(source, target);
+    FSM_CHECK(!first.timerArmed(5) && !first.timerArmed(6));
+    FSM_CHECK(first.tick(now + std::chrono::seconds(60)) == 0);
+    FSM_CHECK(first.currentIndex(6) == armed);
+
+    FSM_CHECK(target.adopt(fsm::span<const std::byte>(block.data(), block.size())));
+    FSM_CHECK(second.timerArmed(5) && second.timerArmed(6));
+    FSM_CHECK(second.tick(now) == 0);
+    FSM_CHECK(second.tick(now + std::chrono::seconds(30)) == 2);
+    FSM_CHECK(second.currentIndex(5) == idle && second.currentIndex(6) == idle);
+}
+
+}  // namespace
+
+int main() {
+    badEventsAreRejected();
+    timersMoveWithThePartition();
+}
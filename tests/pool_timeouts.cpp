@@ -0,0 +1,75 @@
+#include <chrono>
+
+#include <fsm/MachinePool.hpp>
+#include <fsm/actions/After.hpp>
+#include <fsm/actions/ByDefault.hpp>
+#include <fsm/actions/Nothing.hpp>
+#include <fsm/actions/On.hpp>
+#include <fsm/actions/TransitionTo.hpp>
+#include <fsm/actions/Will.hpp>
+
+#include "Check.hpp"
+
+namespace {
+
+struct OpenEvent {
+};
+
+struct ClosedState;
+struct OpenState;
+
+struct ClosedState : fsm::Will<fsm::ByDefault<fsm::Nothing>, fsm::On<OpenEvent, fsm::TransitionTo<OpenState>>> {
+};
+
+struct OpenState : fsm::Will<fsm::ByDefault<fsm::Nothing>,
+                             fsm::After<fsm::timeout_seconds<30>, fsm::TransitionTo<ClosedState>>> {
+};
+
+using Doors = fsm::MachinePool<OpenState, ClosedState>;
+
+constexpr std::size_t open = 0;
+constexpr std::size_t closed = 1;
+
+/**
+ * Timers armed by add() before the first tick, with a steady clock far from 0, run from that
+ * first tick instead of firing on it.
+ */
+void firstTickStartsTheClock() {
+    Doors doors;
+    const auto id = doors.add();
+    FSM_CHECK(doors.timerArmed(id));
+    const auto now = std::chrono::steady_clock::now().time_since_epoch() + std::chrono::hours(24);
+    FSM_CHECK(doors.tick(now) == 0);
+    FSM_CHECK(doors.currentIndex(id) == open);
+    FSM_CHECK(doors.tick(now + std::chrono::seconds(29)) == 0);
+    FSM_CHECK(doors.currentIndex(id) == open);
+    FSM_CHECK(doors.tick(now + std::chrono::seconds(30)) == 1);
+    FSM_CHECK(doors.currentIndex(id) == closed);
+}
+
+/**
+ * Timers armed after the first tick run from the previous tick.
+ */
+void timersAfterFirstTick() {
+    Doors doors;
+    const auto now = std::chrono::steady_clock::now().time_since_epoch();
+    doors.tick(now);
+    const auto first = doors.add();
+    FSM_CHECK(doors.tick(now + std::chrono::seconds(10)) == 0);
+    const auto second = doors.add();
+    FSM_CHECK(doors.tick(now + std::chrono::seconds(30)) == 1);
+    FSM_CHECK(doors.currentIndex(first) == closed);
+    FSM_CHECK(doors.currentIndex(second) == open);
+    doors.handle(first, OpenEvent{});
+    FSM_CHECK(doors.tick(now + std::chrono::seconds(40)) == 1);
+    FSM_CHECK(doors.currentIndex(second) == closed);
+    FSM_CHECK(doors.tick(now + std::chrono::seconds(60)) == 1);
+    FSM_CHECK(doors.currentIndex(first) == closed);
+}
+
+}  // namespace
+
+int main() {
+    firstTickStartsTheClock();
+    timersAfterFirstTick();
+}
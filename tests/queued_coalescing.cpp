@@ -0,0 +1,152 @@
+#include <atomic>
+#include <cstddef>
+#include <thread>
+#include <variant>
+#include <vector>
+
+#include <fsm/QueuedMachine.hpp>
+#include <fsm/StateMachine.hpp>
+#include <fsm/actions/ByDefault.hpp>
+#include <fsm/actions/Nothing.hpp>
+
+#include "Check.hpp"
+
+namespace {
+
+struct Status {
+    int level;
+};
+
+struct Close {
+};
+
+struct Bulk {
+};
+
+}  // namespace
+
+namespace fsm {
+
+template <>
+struct queue_traits<Status> {
+    static constexpr queue_mode mode = queue_mode::coalesce_latest;
+};
+
+template <>
+struct queue_traits<Close> {
+    static constexpr queue_mode mode = queue_mode::drop_duplicates;
+};
+
+}  // End of namespace fsm
+
+namespace {
+
+struct Handled {
+    std::size_t closes = 0;
+    std::size_t bulks = 0;
+    int level = -1;
+};
+
+Handled handled;
+
+struct Count {
+    template <typename Machine, typename State, typename Event>
+    void execute(Machine&, State&, const Event&) {
+    }
+};
+
+struct Counting : fsm::ByDefault<fsm::Nothing> {
+    using ByDefault::handle;
+
+    Count handle(const Status& status) const {
+        handled.level = status.level;
+        return {};
+    }
+
+    Count handle(const Close&) const {
+        ++handled.closes;
+        return {};
+    }
+
+    Count handle(const Bulk&) const {
+        ++handled.bulks;
+        return {};
+    }
+};
+
+using Queue = fsm::QueuedMachine<fsm::StateMachine<Counting>, Status, Close, Bulk>;
+
+/**
+ * Coalesced events posted to a full lane are dropped and give their slot back, so that they
+ * are queued again once the lane drains.
+ */
+void fullLaneGivesSlotsBack() {
+    handled = {};
+    Queue queue(2);
+    FSM_CHECK(queue.post(Bulk{}) && queue.post(Bulk{}));
+    FSM_CHECK(!queue.post(Status{1}));
+    FSM_CHECK(!queue.post(Close{}));
+    FSM_CHECK(!queue.post(Close{}));
+    FSM_CHECK(queue.drain() == 2);
+    FSM_CHECK(queue.post(Status{2}) && queue.post(Close{}) && queue.post(Close{}) && queue.post(Status{3}));
+    FSM_CHECK(queue.drain() == 2);
+    FSM_CHECK(handled.closes == 1 && handled.level == 3 && handled.bulks == 2);
+}
+
+/**
+ * Posters racing on a small lane against a draining thread never leave a slot claimed: once
+ * they are done, the next coalesced events are queued and handled.
+ */
+void racingPostersReleaseSlots() {
+    constexpr std::size_t threadCount = 4;
+    handled = {};
+    Queue queue(2);
+    std::atomic<bool> done{false};
+    std::thread consumer([&queue, &done] {
+        while (!done.load(std::memory_order_acquire)) {
+            queue.drain();
+        }
+    });
+    std::vector<std::thread> posters;
+    for (std::size_t t = 0; t < threadCount; ++t) {
+        posters.emplace_back([&queue] {
+            for (int i = 0; i < 20000; ++i) {
+                queue.post(Bulk{});
+                queue.post(Close{});
+                queue.post(Status{i});
+            }
+        });
+    }
+    for (auto& poster : posters) {
+        poster.join();
+    }
+    done.store(true, std::memory_order_release);
+    consumer.join();
+    queue.drain();
+    FSM_CHECK(queue.empty());
+    const std::size_t closes = handled.closes;
+    FSM_CHECK(queue.post(Close{}) && queue.post(Close{}) && queue.post(Status{-2}));
+    FSM_CHECK(queue.drain() == 2);
+    FSM_CHECK(handled.closes == closes + 1 && handled.level == -2);
+}
+
+/**
+ * Variants are posted as their alternative, coalescing included.
+ */
+void variantsAreCoalesced() {
+    handled = {};
+    Queue queue(8);
+    const std::variant<Close, Status> close{Close{}};
+    FSM_CHECK(queue.post(close) && queue.post(close));
+    FSM_CHECK(queue.post(std::variant<Close, Status>{Status{4}}));
+    FSM_CHECK(queue.drain() == 2);
+    FSM_CHECK(handled.closes == 1 && handled.level == 4);
+}
+
+}  // namespace
+
+int main() {
+    fullLaneGivesSlotsBack();
+    racingPostersReleaseSlots();
+    variantsAreCoalesced();
+}
@@ -0,0 +1,73 @@
+#include <cstddef>
+
+#include <fsm/Replayer.hpp>
+#include <fsm/StateMachine.hpp>
+#include <fsm/actions/ByDefault.hpp>
+#include <fsm/actions/Nothing.hpp>
+#include <fsm/actions/On.hpp>
+#include <fsm/actions/TransitionTo.hpp>
+#include <fsm/actions/Will.hpp>
+#include <fsm/observers/Recorder.hpp>
+#include <fsm/policies/EventQueue.hpp>
+
+#include "Check.hpp"
+
+namespace {
+
+struct Go {
+};
+
+struct Ping {
+};
+
+struct B;
+struct C;
+
+struct A : fsm::Will<fsm::ByDefault<fsm::Nothing>, fsm::On<Go, fsm::TransitionTo<B>>> {
+};
+
+struct B : fsm::Will<fsm::ByDefault<fsm::Nothing>, fsm::On<Ping, fsm::TransitionTo<C>>> {
+    template <typename Poster>
+    void onEnter(const Go&, Poster& poster) {
+        poster.post(Ping{});
+    }
+};
+
+struct C : fsm::ByDefault<fsm::Nothing> {
+};
+
+using Recorded = fsm::Recorder<Go, Ping>;
+
+struct RecordedPolicy : fsm::DefaultPolicy {
+    using EventQueue = fsm::RunToCompletion<4, Go, Ping>;
+    using Observer = Recorded;
+};
+
+using Machine = fsm::BasicStateMachine<RecordedPolicy, A, B, C>;
+
+/**
+ * Events posted by hooks are not recorded: the replay posts them again and ends in the state of
+ * the recorded run.
+ */
+void postedEventsAreReplayedOnce() {
+    alignas(8) static std::byte region[1024];
+    fsm::EventLog log{fsm::span<std::byte>(region, sizeof region)};
+    Recorded::attach(&log);
+    Machine live;
+    live.handle(Go{});
+    Recorded::attach(nullptr);
+    FSM_CHECK(live.currentIndex() == 2);
+    FSM_CHECK(log.count() == 1);
+
+    fsm::Replayer<Go, Ping> replayer;
+    FSM_CHECK(replayer.open(log.bytes()));
+    Machine replayed;
+    FSM_CHECK(replayer.replay(replayed));
+    FSM_CHECK(replayed.currentIndex() == 2);
+}
+
+}  // namespace
+
+int main() {
+    postedEventsAreReplayedOnce();
+}
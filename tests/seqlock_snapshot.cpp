@@ -0,0 +1,88 @@
+#include <array>
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <thread>
+
+#include <fsm/Snapshot.hpp>
+#include <fsm/StateMachine.hpp>
+#include <fsm/actions/ByDefault.hpp>
+#include <fsm/actions/Nothing.hpp>
+#include <fsm/policies/Concurrency.hpp>
+
+#include "Check.hpp"
+
+namespace {
+
+struct Idle : fsm::ByDefault<fsm::Nothing> {
+};
+
+/**
+ * State whose copies are consistent when every word holds the same value.
+ */
+struct Filled : fsm::ByDefault<fsm::Nothing> {
+    std::array<std::uint64_t, 64> words;
+
+    bool consistent() const {
+        for (const std::uint64_t word : words) {
+            if (word != words[0]) {
+                return false;
+            }
+        }
+        return true;
+    }
+};
+
+struct MonitoredPolicy : fsm::DefaultPolicy {
+    using Concurrency = fsm::SeqlockReads;
+};
+
+using Machine = fsm::BasicStateMachine<MonitoredPolicy, Idle, Filled>;
+using Layout = fsm::snapshot_layout<Idle, Filled>;
+
+std::array<std::byte, Layout::size(1)> snapshotOf(std::uint64_t value) {
+    Machine machine;
+    machine.state<Filled>().words.fill(value);
+    machine.transitionTo<Filled>();
+    std::array<std::byte, Layout::size(1)> bytes{};
+    FSM_CHECK(fsm::serialize(machine, fsm::span<std::byte>(bytes.data(), bytes.size())) == bytes.size());
+    return bytes;
+}
+
+/**
+ * Readers on another thread only see whole states while the driver restores snapshots.
+ */
+void readsDuringDeserialize() {
+    const auto ones = snapshotOf(1);
+    const auto twos = snapshotOf(2);
+    Machine machine;
+    FSM_CHECK(fsm::deserialize(machine, fsm::span<const std::byte>(ones.data(), ones.size())));
+    FSM_CHECK(machine.currentIndex() == 1);
+
+    std::atomic<bool> done{false};
+    std::atomic<std::size_t> torn{0};
+    std::thread reader([&machine, &done, &torn] {
+        while (!done.load(std::memory_order_acquire)) {
+            machine.tryReadState<Filled>([&torn](const Filled& filled) {
+                if (!filled.consistent()) {
+                    torn.fetch_add(1);
+                }
+            });
+            std::this_thread::yield();
+        }
+    });
+    for (int round = 0; round < 200000; ++round) {
+        const auto& bytes = round % 2 == 0 ? twos : ones;
+        FSM_CHECK(fsm::deserialize(machine, fsm::span<const std::byte>(bytes.data(), bytes.size())));
+    }
+    done.store(true, std::memory_order_release);
+    reader.join();
+    FSM_CHECK(torn.load() == 0);
+    FSM_CHECK(machine.currentIndex() == 1 && machine.state<Filled>().words[0] == 1);
+}
+
+}  // namespace
+
+int main() {
+    readsDuringDeserialize();
+}
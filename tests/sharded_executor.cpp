@@ -0,0 +1,108 @@
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <ctime>
+#include <thread>
+
+#include <fsm/ShardedExecutor.hpp>
+#include <fsm/StateMachine.hpp>
+#include <fsm/actions/On.hpp>
+
+#include "Check.hpp"
+
+namespace {
+
+struct Tick {
+    std::uint32_t n;
+};
+
+std::atomic<std::uint32_t> handled{0};
+std::atomic<std::uint32_t> probes{0};
+
+struct Add {
+    template <typename Machine, typename State>
+    void execute(Machine&, State& state, const Tick& tick) {
+        state.sum += tick.n;
+        handled.fetch_add(1);
+        if (tick.n == 0) {
+            probes.fetch_add(1);
+        }
+    }
+};
+
+struct Counting : fsm::On<Tick, Add> {
+    std::uint64_t sum = 0;
+};
+
+using Counter = fsm::StateMachine<Counting>;
+
+std::uint64_t sumOf(fsm::ShardedExecutor<Counter, Tick>& executor, std::uint64_t id) {
+    return executor.find(id)->state<Counting>().sum;
+}
+
+/**
+ * Idle workers park instead of spinning, and wake up for events posted afterwards.
+ */
+void idleWorkersPark() {
+    fsm::ShardedExecutor<Counter, Tick> executor{2};
+    for (std::uint64_t id = 0; id < 8; ++id) {
+        executor.add(id);
+    }
+    executor.start();
+    std::this_thread::sleep_for(std::chrono::milliseconds(50));
+    const std::clock_t before = std::clock();
+    const auto start = std::chrono::steady_clock::now();
+    std::this_thread::sleep_for(std::chrono::milliseconds(300));
+    const double cpu = static_cast<double>(std::clock() - before) / CLOCKS_PER_SEC;
+    const double wall = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    FSM_CHECK(cpu < wall / 4);
+
+    for (std::uint32_t n = 1; n <= 100; ++n) {
+        for (std::uint64_t id = 0; id < 8; ++id) {
+            while (!executor.post(id, Tick{n})) {
+            }
+        }
+    }
+    const auto deadline = std::chrono::steady_clock::now() + std::chrono::seconds(10);
+    while (handled.load() < 800 && std::chrono::steady_clock::now() < deadline) {
+        std::this_thread::sleep_for(std::chrono::milliseconds(1));
+    }
+    executor.stop();
+    FSM_CHECK(handled.load() == 800);
+    for (std::uint64_t id = 0; id < 8; ++id) {
+        FSM_CHECK(sumOf(executor, id) == 5050);
+    }
+}
+
+/**
+ * A machine flooded with events does not keep its worker from the other machines of its shard.
+ */
+void floodedMachinesYield() {
+    fsm::ShardedExecutor<Counter, Tick> executor{1};
+    executor.add(0);
+    executor.add(1);
+    executor.start();
+    std::atomic<bool> flooding{true};
+    std::thread flood([&executor, &flooding] {
+        while (flooding.load(std::memory_order_relaxed)) {
+            executor.post(0, Tick{1});
+        }
+    });
+    while (!executor.post(1, Tick{0})) {
+    }
+    const auto deadline = std::chrono::steady_clock::now() + std::chrono::seconds(10);
+    while (probes.load() == 0 && std::chrono::steady_clock::now() < deadline) {
+        std::this_thread::sleep_for(std::chrono::milliseconds(1));
+    }
+    flooding.store(false, std::memory_order_relaxed);
+    flood.join();
+    executor.stop();
+    FSM_CHECK(probes.load() == 1);
+}
+
+}  // namespace
+
+int main() {
+    idleWorkersPark();
+    floodedMachinesYield();
+}
@@ -0,0 +1,88 @@
+#include <cstddef>
+#include <memory>
+#include <variant>
+
+#include <fsm/QueuedMachine.hpp>
+#include <fsm/StateMachine.hpp>
+#include <fsm/actions/ByDefault.hpp>
+#include <fsm/actions/Nothing.hpp>
+#include <fsm/actions/On.hpp>
+#include <fsm/actions/TransitionTo.hpp>
+#include <fsm/actions/Will.hpp>
+
+#include "Check.hpp"
+
+namespace {
+
+struct Tick {
+};
+
+struct Flip {
+};
+
+std::size_t entries = 0;
+std::size_t exits = 0;
+
+struct Waiting;
+
+struct Ticking : fsm::Will<fsm::ByDefault<fsm::Nothing>, fsm::On<Tick, fsm::TransitionTo<Ticking>>,
+                           fsm::On<Flip, fsm::TransitionTo<Waiting>>> {
+    template <typename Event>
+    void onEnter(const Event&) {
+        ++entries;
+    }
+
+    template <typename Event>
+    void onLeave(const Event&) {
+        FSM_CHECK(marker == 0x5a5a);
+        ++exits;
+    }
+
+    unsigned marker = 0x5a5a;
+};
+
+struct Waiting : fsm::Will<fsm::ByDefault<fsm::Nothing>, fsm::On<Tick, fsm::TransitionTo<Ticking>>> {
+};
+
+struct InPlacePolicy : fsm::DefaultPolicy {
+    using Storage = fsm::InPlaceStorage;
+};
+
+struct ArenaPolicy : fsm::DefaultPolicy {
+    using Storage = fsm::ArenaStorage<std::allocator<std::byte>>;
+};
+
+/**
+ * Self-transitions rebuild the only state kept by the storage, which later events of the same
+ * batch see again.
+ */
+template <class Policy>
+void batchesSelfTransition() {
+    using Machine = fsm::BasicStateMachine<Policy, Ticking, Waiting>;
+    entries = 0;
+    exits = 0;
+    Machine machine;
+    const Tick ticks[4] = {};
+    machine.handleBatch(fsm::span<const Tick>(ticks, 4));
+    FSM_CHECK(entries == 4 && exits == 4 && machine.currentIndex() == 0);
+
+    using Event = std::variant<Tick, Flip>;
+    const Event events[] = {Tick{}, Flip{}, Tick{}, Tick{}, Tick{}};
+    machine.handleBatch(fsm::span<const Event>(events, 5));
+    FSM_CHECK(entries == 8 && exits == 8 && machine.currentIndex() == 0);
+
+    fsm::QueuedMachine<Machine, Tick, Flip> queue(8);
+    for (int i = 0; i < 4; ++i) {
+        FSM_CHECK(queue.post(Tick{}));
+    }
+    FSM_CHECK(queue.post(Flip{}) && queue.post(Tick{}));
+    FSM_CHECK(queue.drain() == 6);
+    FSM_CHECK(entries == 13 && exits == 13 && queue.machine().currentIndex() == 0);
+}
+
+}  // namespace
+
+int main() {
+    batchesSelfTransition<InPlacePolicy>();
+    batchesSelfTransition<ArenaPolicy>();
+}
@@ -0,0 +1,90 @@
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+
+#include <fsm/StateMachine.hpp>
+#include <fsm/actions/ByDefault.hpp>
+#include <fsm/actions/Nothing.hpp>
+#include <fsm/actions/On.hpp>
+#include <fsm/actions/TransitionTo.hpp>
+#include <fsm/actions/Will.hpp>
+#include <fsm/tools/EventView.hpp>
+
+#include "Check.hpp"
+
+namespace {
+
+struct Quote {
+    std::uint64_t price;
+};
+
+struct QuoteView : fsm::EventView {
+    using EventView::EventView;
+
+    static constexpr std::size_t min_size = 8;
+
+    std::uint64_t price() const {
+        return field<std::uint64_t, 0>();
+    }
+
+    bool quantity(std::uint32_t& out) const {
+        return tryField<std::uint32_t, 8>(out);
+    }
+};
+
+struct Quoted;
+
+struct Idle : fsm::Will<fsm::ByDefault<fsm::Nothing>, fsm::On<Quote, fsm::TransitionTo<Quoted>>,
+                        fsm::On<QuoteView, fsm::TransitionTo<Quoted>>> {
+};
+
+struct Quoted : fsm::ByDefault<fsm::Nothing> {
+};
+
+using Book = fsm::StateMachine<Idle, Quoted>;
+
+/**
+ * Frames shorter than the event they are tagged with are rejected without touching the machine.
+ */
+void shortFramesAreRejected() {
+    std::array<std::byte, 12> bytes{};
+    const std::uint64_t price = 42;
+    std::memcpy(bytes.data(), &price, sizeof(price));
+    const fsm::span<const std::byte> frame{bytes.data(), bytes.size()};
+
+    Book book;
+    FSM_CHECK(!book.handleTagged<Quote>(0, frame.first(7)));
+    FSM_CHECK(!book.handleTagged<Quote>(1, frame));
+    FSM_CHECK(book.currentIndex() == 0);
+    FSM_CHECK((!book.handleTagged<Quote, QuoteView>(1, frame.first(7))));
+    FSM_CHECK(book.currentIndex() == 0);
+    FSM_CHECK(book.handleTagged<Quote>(0, frame.first(8)));
+    FSM_CHECK(book.currentIndex() == 1);
+
+    Book viewed;
+    FSM_CHECK((viewed.handleTagged<Quote, QuoteView>(1, frame.first(8))));
+    FSM_CHECK(viewed.currentIndex() == 1);
+}
+
+/**
+ * Views check their optional fields against the frame they were built over.
+ */
+void viewFieldsAreChecked() {
+    std::array<std::byte, 12> bytes{};
+    const std::uint32_t quantity = 7;
+    std::memcpy(bytes.data() + 8, &quantity, sizeof(quantity));
+    std::uint32_t out = 0;
+    const QuoteView shortView{fsm::span<const std::byte>{bytes.data(), 11}};
+    FSM_CHECK(shortView.fits<8>() && !shortView.fits<12>());
+    FSM_CHECK(!shortView.quantity(out) && out == 0);
+    const QuoteView fullView{fsm::span<const std::byte>{bytes.data(), bytes.size()}};
+    FSM_CHECK(fullView.quantity(out) && out == 7);
+}
+
+}  // namespace
+
+int main() {
+    shortFramesAreRejected();
+    viewFieldsAreChecked();
+}